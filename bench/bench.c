@@ -0,0 +1,221 @@
+/*
+ * RingLight Bench - Benchmarks for overlay and monitor hot paths
+ *
+ *   fill     the panel fill kernels against the original scalar loop, and
+ *            whole shm buffer creation (memfd, mmap, fill) per panel shape
+ *   exec     the monitor's matcher and pid set under a synthetic exec storm
+ *   startup  standalone overlay cold start against a daemon show, under a
+ *            headless compositor
+ *
+ * Buffers are memfd-backed shared mappings, the same kind of memory the
+ * overlay hands to the compositor.
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "bench.h"
+#include "fill.h"
+
+#ifndef RINGLIGHT_VERSION
+#define RINGLIGHT_VERSION "dev"
+#endif
+#ifndef RINGLIGHT_OVERLAY
+#define RINGLIGHT_OVERLAY "ringlight-overlay"
+#endif
+#define DEFAULT_COMPOSITOR "kwin_wayland --virtual --no-lockscreen"
+
+static const struct { const char *name; size_t width, height; } resolutions[] = {
+    { "1080p", 1920, 1080 },
+    { "1440p", 2560, 1440 },
+    { "4K",    3840, 2160 },
+};
+
+static const struct { const char *name; void (*fn)(uint32_t *, uint32_t, size_t); } kernels[] = {
+    { "scalar",   fill_pixels_scalar },
+    { "dispatch", fill_pixels },
+    { "doubling", fill_pixels_doubling },
+};
+
+/* What render_panel() asks for: a shm-tile, one ring strip, a fullscreen panel */
+static const struct { const char *name; int tile, strip; } shapes[] = {
+    { "tile",  1, 0 },
+    { "strip", 0, 1 },
+    { "full",  0, 0 },
+};
+
+#define STRIP_WIDTH 80
+
+bool bench_json = false;
+static FILE *records;
+static char *records_buf;
+static size_t records_len;
+static int num_records;
+
+double bench_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+void bench_record(const char *suite, const char *fmt, ...) {
+    if (!bench_json) return;
+    if (!records) records = open_memstream(&records_buf, &records_len);
+    if (!records) { perror("open_memstream"); exit(1); }
+    fprintf(records, "%s{\"suite\":\"%s\",", num_records++ ? "," : "", suite);
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(records, fmt, ap);
+    va_end(ap);
+    fputc('}', records);
+}
+
+void bench_skip(const char *suite, const char *reason) {
+    fprintf(stderr, "%s: skipped, %s\n", suite, reason);
+    bench_record(suite, "\"skipped\":true");
+}
+
+static uint32_t *map_shared(size_t size) {
+    int fd = memfd_create("ringlight-bench", 0);
+    if (fd < 0 || ftruncate(fd, size) < 0) { perror("memfd"); exit(1); }
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) { perror("mmap"); exit(1); }
+    return data;
+}
+
+/* The overlay's buffer path, short of handing the fd to wl_shm */
+static void bench_buffers(int iterations) {
+    TEXT("\nBuffer creation (memfd + mmap + fill + unmap)\n");
+    TEXT("%-6s %-6s %11s %10s %10s\n", "res", "shape", "size", "best us", "mean us");
+
+    for (size_t r = 0; r < NUM(resolutions); r++) {
+        for (size_t s = 0; s < NUM(shapes); s++) {
+            size_t w = resolutions[r].width, h = resolutions[r].height;
+            if (shapes[s].tile) w = h = 16;
+            else if (shapes[s].strip) h = STRIP_WIDTH;
+            size_t count = w * h, size = count * 4;
+
+            double best = 1e18, total = 0;
+            for (int i = 0; i < iterations; i++) {
+                double t0 = bench_now_us();
+                uint32_t *buf = map_shared(size);
+                fill_pixels(buf, 0xFFFFFFFFu, count);
+                munmap(buf, size);
+                double dt = bench_now_us() - t0;
+                if (dt < best) best = dt;
+                total += dt;
+            }
+            char dims[24];
+            snprintf(dims, sizeof(dims), "%zux%zu", w, h);
+            TEXT("%-6s %-6s %11s %10.1f %10.1f\n", resolutions[r].name, shapes[s].name, dims,
+                 best, total / iterations);
+            bench_record("buffer", "\"res\":\"%s\",\"shape\":\"%s\",\"width\":%zu,\"height\":%zu,"
+                         "\"best_us\":%.1f,\"mean_us\":%.1f",
+                         resolutions[r].name, shapes[s].name, w, h, best, total / iterations);
+        }
+    }
+}
+
+void bench_fill(int iterations) {
+    TEXT("Fill kernels (dispatch = %s, streaming from %u KiB)\n",
+         fill_kernel_name(), FILL_STREAM_THRESHOLD / 1024);
+    TEXT("%-6s %-9s %10s %10s %9s\n", "res", "kernel", "best us", "mean us", "GB/s");
+
+    for (size_t r = 0; r < NUM(resolutions); r++) {
+        size_t count = resolutions[r].width * resolutions[r].height;
+        size_t size = count * 4;
+        uint32_t *buf = map_shared(size);
+        fill_pixels_scalar(buf, 0, count);    /* fault pages in outside the timing */
+
+        for (size_t k = 0; k < NUM(kernels); k++) {
+            double best = 1e18, total = 0;
+            for (int i = 0; i < iterations; i++) {
+                uint32_t pixel = 0xFF000000u | (uint32_t)(i * 0x010101);
+                double t0 = bench_now_us();
+                kernels[k].fn(buf, pixel, count);
+                double dt = bench_now_us() - t0;
+                if (buf[count - 1] != pixel) { fprintf(stderr, "%s: bad fill\n", kernels[k].name); exit(1); }
+                if (dt < best) best = dt;
+                total += dt;
+            }
+            TEXT("%-6s %-9s %10.1f %10.1f %9.2f\n", resolutions[r].name, kernels[k].name,
+                 best, total / iterations, size / best / 1e3);
+            bench_record("fill", "\"res\":\"%s\",\"kernel\":\"%s\",\"best_us\":%.1f,"
+                         "\"mean_us\":%.1f,\"gbps\":%.2f",
+                         resolutions[r].name, kernels[k].name, best, total / iterations,
+                         size / best / 1e3);
+        }
+        munmap(buf, size);
+    }
+    bench_buffers(iterations);
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options] [fill|exec|startup ...]\n\n"
+           "  -n, --iterations N     Repetitions per measurement (default: 20)\n"
+           "  -j, --json             Print one JSON document instead of tables\n"
+           "  -o, --overlay PATH     Overlay binary for startup (default: %s)\n"
+           "  -C, --compositor CMD   Headless compositor for startup (default: %s),\n"
+           "                         or 'current' to use $WAYLAND_DISPLAY\n"
+           "  -h, --help             Show help\n\n"
+           "Runs fill and exec by default; startup needs a compositor with wlr-layer-shell.\n",
+           prog, RINGLIGHT_OVERLAY, DEFAULT_COMPOSITOR);
+}
+
+int main(int argc, char *argv[]) {
+    static struct option opts[] = {
+        {"iterations", required_argument, 0, 'n'},
+        {"json", no_argument, 0, 'j'},
+        {"overlay", required_argument, 0, 'o'},
+        {"compositor", required_argument, 0, 'C'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int iterations = 20;
+    const char *overlay = RINGLIGHT_OVERLAY, *compositor = DEFAULT_COMPOSITOR;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:jo:C:h", opts, NULL)) != -1) {
+        switch (opt) {
+        case 'n': iterations = atoi(optarg); if (iterations < 1) iterations = 1; break;
+        case 'j': bench_json = true; break;
+        case 'o': overlay = optarg; break;
+        case 'C': compositor = optarg; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+
+    bool fill = optind == argc, exec = optind == argc, startup = false;
+    for (int i = optind; i < argc; i++) {
+        if (strcmp(argv[i], "fill") == 0) fill = true;
+        else if (strcmp(argv[i], "exec") == 0) exec = true;
+        else if (strcmp(argv[i], "startup") == 0) startup = true;
+        else { usage(argv[0]); return 1; }
+    }
+
+    if (fill) bench_fill(iterations);
+    if (exec) { TEXT("%s", fill ? "\n" : ""); bench_exec_storm(iterations); }
+    if (startup) { TEXT("%s", fill || exec ? "\n" : ""); bench_startup(iterations, overlay, compositor); }
+
+    if (bench_json) {
+        if (records) fclose(records);
+        printf("{\"bench\":\"ringlight\",\"version\":\"%s\",\"fill_kernel\":\"%s\","
+               "\"iterations\":%d,\"timestamp\":%lld,\"results\":[%s]}\n",
+               RINGLIGHT_VERSION, fill_kernel_name(), iterations, (long long)time(NULL),
+               records_buf ? records_buf : "");
+        free(records_buf);
+    }
+    return 0;
+}
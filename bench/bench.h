@@ -0,0 +1,38 @@
+/*
+ * RingLight Bench - Shared helpers for the benchmark suites
+ *
+ * Each suite prints a table for people and, with --json, one record per
+ * measurement instead. Records are JSON object bodies; bench_record()
+ * wraps them in {"suite":...} and collects them into a single document
+ * on stdout so runs can be archived and compared across releases.
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef RINGLIGHT_BENCH_H
+#define RINGLIGHT_BENCH_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define NUM(a) (sizeof(a) / sizeof((a)[0]))
+
+extern bool bench_json;
+
+/* Table output, suppressed in JSON mode */
+#define TEXT(...) do { if (!bench_json) printf(__VA_ARGS__); } while (0)
+
+double bench_now_us(void);
+
+/* Append {"suite":suite,<fmt>} to the results; a no-op in text mode */
+void bench_record(const char *suite, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/* Note why a suite could not run, in either mode */
+void bench_skip(const char *suite, const char *reason);
+
+void bench_fill(int iterations);
+void bench_exec_storm(int iterations);
+void bench_startup(int iterations, const char *overlay, const char *compositor);
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * RingLight Bench - Monitor event throughput under an exec storm
+ *
+ * Replays a synthetic burst of proc connector messages through the same
+ * steps as the monitor's drain_netlink()/process_netlink_event(): walk the
+ * netlink batch, decode each proc_event, match execs against the watch
+ * list and keep the pid set in step with execs and exits. The compiled
+ * matcher runs on in-memory comm/cmdline here, so the numbers are the
+ * monitor's own CPU cost; the /proc rows add the reads a real event pays.
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+
+#include "bench.h"
+#include "matcher.h"
+#include "pidset.h"
+
+#define STORM_EVENTS 100000
+#define STORM_PIDS 4096         /* distinct pids alive during the storm */
+#define MSG_SIZE NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(struct proc_event))
+#define PROC_SAMPLE 256
+
+/* What a busy desktop execs; cmdline arguments are NUL-separated as in /proc */
+static const struct { const char *comm; const char *cmdline; size_t len; } population[] = {
+#define P(comm, cmdline) { comm, cmdline, sizeof(cmdline) - 1 }
+    P("bash",     "/bin/bash\0-c\0make -j8"),
+    P("make",     "make\0-j8"),
+    P("cc1",      "/usr/lib/gcc/x86_64-linux-gnu/13/cc1\0-quiet\0src/monitor.c"),
+    P("ld",       "/usr/bin/ld\0-o\0ringlight-monitor"),
+    P("git",      "git\0status\0--porcelain"),
+    P("python3",  "/usr/bin/python3\0/usr/lib/howdy/compare.py\0bryan"),
+    P("sed",      "sed\0-n\0s/a/b/p"),
+    P("grep",     "grep\0-r\0TODO\0src"),
+    P("kworker",  "kworker/u16:3"),
+    P("howdy",    "/usr/bin/howdy\0test"),
+#undef P
+};
+
+/* Watch lists of growing size; the monitor's default is just "howdy" */
+static const char *watch_words[] = {
+    "howdy", "=zoom", "obs", "teams", "=cheese", "guvcview", "webcamoid", "kamoso",
+    "=skypeforlinux", "discord", "slack", "signal-desktop", "telegram", "jitsi", "=vlc", "mpv",
+};
+static const int watch_sizes[] = { 1, 4, 16 };
+
+/* matcher_legacy_match_pid() on in-memory data: a strcasecmp and strcasestr per entry */
+static bool legacy_match(char *const *patterns, int count, const char *comm, const char *cmdline) {
+    for (int i = 0; i < count; i++) {
+        const char *name = patterns[i];
+        bool comm_only = name[0] == '=';
+        if (comm_only) name++;
+        if (strcasecmp(comm, name) == 0) return true;
+        if (!comm_only && strcasestr(cmdline, name)) return true;
+    }
+    return false;
+}
+
+/* Each pid execs and then exits, one proc_event per netlink message as the kernel sends them */
+static char *build_storm(size_t *len) {
+    char *buf = calloc(STORM_EVENTS, MSG_SIZE);
+    if (!buf) { perror("calloc"); exit(1); }
+    for (int i = 0; i < STORM_EVENTS; i++) {
+        struct nlmsghdr *nlh = (struct nlmsghdr *)(buf + (size_t)i * MSG_SIZE);
+        nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(struct proc_event));
+        nlh->nlmsg_type = NLMSG_DONE;
+        struct cn_msg *cn = NLMSG_DATA(nlh);
+        cn->id.idx = CN_IDX_PROC;
+        cn->id.val = CN_VAL_PROC;
+        cn->len = sizeof(struct proc_event);
+        struct proc_event *ev = (struct proc_event *)cn->data;
+        pid_t pid = 1000 + (i / 2) % STORM_PIDS;
+        if (i % 2 == 0) {
+            ev->what = PROC_EVENT_EXEC;
+            ev->event_data.exec.process_pid = pid;
+        } else {
+            ev->what = PROC_EVENT_EXIT;
+            ev->event_data.exit.process_pid = pid;
+        }
+    }
+    *len = (size_t)STORM_EVENTS * MSG_SIZE;
+    return buf;
+}
+
+typedef struct {
+    const matcher_t *matcher;       /* NULL: legacy */
+    char *const *patterns;
+    int count;
+    pidset_t watched;
+    unsigned long matched;
+} storm_t;
+
+static bool storm_match(storm_t *st, pid_t pid) {
+    size_t p = (size_t)pid % NUM(population);
+    if (!st->matcher) {
+        char cmdline[256];
+        size_t n = population[p].len < sizeof(cmdline) - 1 ? population[p].len : sizeof(cmdline) - 1;
+        memcpy(cmdline, population[p].cmdline, n);
+        cmdline[n] = '\0';
+        for (size_t k = 0; k + 1 < n; k++) if (!cmdline[k]) cmdline[k] = ' ';
+        return legacy_match(st->patterns, st->count, population[p].comm, cmdline);
+    }
+    if (matcher_match_comm(st->matcher, population[p].comm, strlen(population[p].comm))) return true;
+    return matcher_needs_cmdline(st->matcher) &&
+           matcher_match_cmdline(st->matcher, population[p].cmdline, population[p].len);
+}
+
+static void storm_replay(storm_t *st, char *buf, size_t len) {
+    int remaining = (int)len;
+    for (struct nlmsghdr *nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, remaining); nlh = NLMSG_NEXT(nlh, remaining)) {
+        if (nlh->nlmsg_type == NLMSG_NOOP || nlh->nlmsg_type == NLMSG_ERROR) continue;
+        if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(struct proc_event))) continue;
+        struct cn_msg *cn = NLMSG_DATA(nlh);
+        struct proc_event *ev = (struct proc_event *)cn->data;
+        if (ev->what == PROC_EVENT_EXEC) {
+            pid_t pid = ev->event_data.exec.process_pid;
+            if (storm_match(st, pid)) { pidset_insert(&st->watched, pid, -1); st->matched++; }
+        } else if (ev->what == PROC_EVENT_EXIT) {
+            if (st->watched.count > 0) pidset_remove(&st->watched, ev->event_data.exit.process_pid, NULL);
+        }
+    }
+}
+
+static int sample_pids(pid_t *pids, int max) {
+    DIR *d = opendir("/proc");
+    if (!d) return 0;
+    int n = 0;
+    struct dirent *e;
+    while (n < max && (e = readdir(d)))
+        if (isdigit((unsigned char)e->d_name[0])) pids[n++] = atoi(e->d_name);
+    closedir(d);
+    return n;
+}
+
+void bench_exec_storm(int iterations) {
+    size_t len;
+    char *storm = build_storm(&len);
+    pid_t pids[PROC_SAMPLE];
+    int npids = sample_pids(pids, PROC_SAMPLE);
+
+    TEXT("Exec storm (%d events over %d pids, in memory; /proc over %d live pids)\n",
+         STORM_EVENTS, STORM_PIDS, npids);
+    TEXT("%-8s %-9s %-8s %12s %10s\n", "watch", "matcher", "source", "Mevents/s", "ns/event");
+
+    for (size_t w = 0; w < NUM(watch_sizes); w++) {
+        int count = watch_sizes[w];
+        char *const *patterns = (char *const *)watch_words;
+        matcher_t *compiled = matcher_new(patterns, count);
+        if (!compiled) { fprintf(stderr, "matcher_new failed\n"); exit(1); }
+
+        for (int legacy = 0; legacy < 2; legacy++) {
+            const char *name = legacy ? "legacy" : "compiled";
+
+            double best = 1e18;
+            unsigned long matched = 0;
+            for (int i = 0; i < iterations; i++) {
+                storm_t st = { .matcher = legacy ? NULL : compiled, .patterns = patterns, .count = count };
+                double t0 = bench_now_us();
+                storm_replay(&st, storm, len);
+                double dt = bench_now_us() - t0;
+                if (dt < best) best = dt;
+                matched = st.matched;
+                pidset_free(&st.watched);
+            }
+            double ns = best * 1e3 / STORM_EVENTS;
+            TEXT("%-8d %-9s %-8s %12.2f %10.1f\n", count, name, "memory", STORM_EVENTS / best, ns);
+            bench_record("exec", "\"watch\":%d,\"matcher\":\"%s\",\"source\":\"memory\",\"events\":%d,"
+                         "\"matched\":%lu,\"best_us\":%.1f,\"ns_per_event\":%.1f",
+                         count, name, STORM_EVENTS, matched, best, ns);
+
+            if (npids == 0) continue;
+            best = 1e18;
+            for (int i = 0; i < iterations; i++) {
+                double t0 = bench_now_us();
+                for (int k = 0; k < npids; k++) {
+                    if (legacy) matcher_legacy_match_pid(patterns, count, pids[k], NULL);
+                    else matcher_match_pid(compiled, pids[k], NULL);
+                }
+                double dt = bench_now_us() - t0;
+                if (dt < best) best = dt;
+            }
+            ns = best * 1e3 / npids;
+            TEXT("%-8d %-9s %-8s %12.2f %10.1f\n", count, name, "proc", npids / best, ns);
+            bench_record("exec", "\"watch\":%d,\"matcher\":\"%s\",\"source\":\"proc\",\"events\":%d,"
+                         "\"best_us\":%.1f,\"ns_per_event\":%.1f",
+                         count, name, npids, best, ns);
+        }
+        matcher_free(compiled);
+    }
+    free(storm);
+}
@@ -0,0 +1,289 @@
+/*
+ * RingLight Bench - Overlay cold start against a daemon show
+ *
+ * Cold: spawn `ringlight-overlay -s all --timing` and wait for the timing
+ * line it prints at its first commit, so the figure includes exec, linking,
+ * the compositor round trips and the first buffer. Daemon: an already
+ * connected `ringlight-overlay --daemon` is sent "show t0=..." and its
+ * trace is read back, giving configure, commit and presented marks on the
+ * same CLOCK_MONOTONIC microseconds.
+ *
+ * Everything runs in a private XDG_RUNTIME_DIR, which keeps a user's own
+ * overlay daemon out of the way. The headless compositor is started there
+ * and picked up by the wayland-* socket it creates; it has to implement
+ * wlr-layer-shell (kwin_wayland --virtual, or sway with
+ * WLR_BACKENDS=headless; weston does not). With 'current', the session's
+ * compositor is used instead.
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "bench.h"
+#include "control.h"
+
+#define COMPOSITOR_WAIT_MS 10000
+#define FIRST_COMMIT_WAIT_MS 5000
+#define DAEMON_WAIT_MS 5000
+#define PRESENTED_WAIT_MS 1000
+
+extern char **environ;
+
+static char runtime_dir[] = "/tmp/ringlight-bench-XXXXXX";
+static pid_t compositor_pid = -1;
+
+static pid_t spawn(char *const argv[], int stderr_fd, bool own_group) {
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawnattr_init(&attr);
+    if (stderr_fd >= 0) posix_spawn_file_actions_adddup2(&fa, stderr_fd, STDERR_FILENO);
+    posix_spawn_file_actions_addopen(&fa, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    if (own_group) {
+        posix_spawnattr_setpgroup(&attr, 0);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    }
+    pid_t pid;
+    int err = posix_spawnp(&pid, argv[0], &fa, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    if (err) { errno = err; return -1; }
+    return pid;
+}
+
+static void reap(pid_t pid, bool group) {
+    if (pid <= 0) return;
+    kill(group ? -pid : pid, SIGTERM);
+    for (int i = 0; i < 200; i++) {
+        if (waitpid(pid, NULL, WNOHANG) == pid) return;
+        usleep(10000);
+    }
+    kill(group ? -pid : pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
+/* A compositor's socket is any wayland-N in the runtime dir without a .lock suffix */
+static bool find_socket(char *name, size_t len) {
+    DIR *d = opendir(runtime_dir);
+    if (!d) return false;
+    struct dirent *e;
+    bool found = false;
+    while (!found && (e = readdir(d))) {
+        if (strncmp(e->d_name, "wayland-", 8) != 0 || strchr(e->d_name, '.')) continue;
+        snprintf(name, len, "%s", e->d_name);
+        found = true;
+    }
+    closedir(d);
+    return found;
+}
+
+static bool start_compositor(const char *cmd) {
+    if (strcmp(cmd, "current") == 0) {
+        const char *display = getenv("WAYLAND_DISPLAY"), *dir = getenv("XDG_RUNTIME_DIR");
+        if (!display) return false;
+        char path[PATH_MAX];
+        if (display[0] != '/' && dir) snprintf(path, sizeof(path), "%s/%s", dir, display);
+        else snprintf(path, sizeof(path), "%s", display);
+        setenv("WAYLAND_DISPLAY", path, 1);
+        setenv("XDG_RUNTIME_DIR", runtime_dir, 1);
+        return true;
+    }
+
+    setenv("XDG_RUNTIME_DIR", runtime_dir, 1);
+    unsetenv("WAYLAND_DISPLAY");
+    unsetenv("DISPLAY");
+    int devnull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    char *argv[] = { "/bin/sh", "-c", (char *)cmd, NULL };
+    compositor_pid = spawn(argv, devnull, true);
+    if (devnull >= 0) close(devnull);
+    if (compositor_pid < 0) return false;
+
+    char name[NAME_MAX + 1];
+    for (int waited = 0; waited < COMPOSITOR_WAIT_MS; waited += 20) {
+        if (find_socket(name, sizeof(name))) {
+            setenv("WAYLAND_DISPLAY", name, 1);
+            return true;
+        }
+        if (waitpid(compositor_pid, NULL, WNOHANG) == compositor_pid) { compositor_pid = -1; return false; }
+        usleep(20000);
+    }
+    return false;
+}
+
+static void remove_runtime_dir(void) {
+    DIR *d = opendir(runtime_dir);
+    if (!d) return;
+    struct dirent *e;
+    while ((e = readdir(d))) {
+        if (e->d_name[0] == '.') continue;
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", runtime_dir, e->d_name);
+        unlink(path);
+    }
+    closedir(d);
+    rmdir(runtime_dir);
+}
+
+/* Spawn to first commit, from the overlay's own --timing line; -1 if it never came */
+static double cold_start(const char *overlay, double *commit_us) {
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) < 0) return -1;
+    char *argv[] = { (char *)overlay, "-s", "all", "--timing", NULL };
+    double t0 = bench_now_us();
+    pid_t pid = spawn(argv, pipefd[1], false);
+    close(pipefd[1]);
+    if (pid < 0) { close(pipefd[0]); return -1; }
+
+    char buf[1024];
+    size_t got = 0;
+    double wall = -1;
+    while (got < sizeof(buf) - 1) {
+        struct pollfd pfd = { .fd = pipefd[0], .events = POLLIN };
+        int remaining = FIRST_COMMIT_WAIT_MS - (int)((bench_now_us() - t0) / 1000);
+        if (remaining <= 0 || poll(&pfd, 1, remaining) <= 0) break;
+        ssize_t n = read(pipefd[0], buf + got, sizeof(buf) - 1 - got);
+        if (n <= 0) break;
+        got += n;
+        buf[got] = '\0';
+        const char *line = strstr(buf, "timing:");
+        if (line && strchr(line, '\n')) {
+            wall = bench_now_us() - t0;
+            const char *c = strstr(line, "first commit ");
+            *commit_us = c ? atof(c + 13) : 0;
+            break;
+        }
+    }
+    close(pipefd[0]);
+    reap(pid, false);
+    return wall;
+}
+
+static unsigned long long trace_mark(const char *reply, const char *key) {
+    const char *p = strstr(reply, key);
+    return p ? strtoull(p + strlen(key), NULL, 10) : 0;
+}
+
+/* Show on the daemon; fills configure/commit/presented in us after t0 */
+static bool daemon_show(const char *sock, double *rtt, double *configure, double *commit, double *presented) {
+    char cmd[128], reply[CTL_LINE_MAX];
+    ctl_request(sock, "hide", reply, sizeof(reply), 500);
+    usleep(50000);      /* let the compositor unmap the old panels */
+
+    unsigned long long t0 = (unsigned long long)bench_now_us();
+    snprintf(cmd, sizeof(cmd), "show screen=all t0=%llu", t0);
+    if (ctl_request(sock, cmd, reply, sizeof(reply), 1000) < 0) return false;
+    *rtt = bench_now_us() - t0;
+
+    unsigned long long c = 0, p = 0, cfg = 0;
+    double deadline = bench_now_us() + PRESENTED_WAIT_MS * 1000.0;
+    while (bench_now_us() < deadline) {
+        if (ctl_request(sock, "trace", reply, sizeof(reply), 500) < 0) return false;
+        cfg = trace_mark(reply, "configure=");
+        c = trace_mark(reply, "commit=");
+        p = trace_mark(reply, "presented=");
+        if (c && p) break;
+        usleep(1000);
+    }
+    if (!c) return false;
+    *configure = cfg ? (double)(cfg - t0) : 0;
+    *commit = (double)(c - t0);
+    *presented = p ? (double)(p - t0) : -1;
+    return true;
+}
+
+static void run_daemon(int iterations, const char *overlay) {
+    char sock[PATH_MAX], reply[CTL_LINE_MAX];
+    if (!ctl_socket_path(CTL_OVERLAY_SOCKET, sock, sizeof(sock))) return;
+    int devnull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    char *argv[] = { (char *)overlay, "--daemon", NULL };
+    pid_t pid = spawn(argv, devnull, false);
+    if (devnull >= 0) close(devnull);
+    if (pid < 0) { bench_skip("startup", "overlay daemon failed to start"); return; }
+
+    bool up = false;
+    for (int waited = 0; waited < DAEMON_WAIT_MS && !up; waited += 10) {
+        up = ctl_request(sock, "ping", reply, sizeof(reply), 100) == 0;
+        if (!up) usleep(10000);
+    }
+    if (!up) { bench_skip("startup", "overlay daemon never answered"); reap(pid, false); return; }
+
+    double best[4] = { 1e18, 1e18, 1e18, 1e18 }, total[4] = { 0 };
+    int runs = 0;
+    bool have_presented = true;
+    for (int i = 0; i < iterations; i++) {
+        double m[4];
+        if (!daemon_show(sock, &m[0], &m[1], &m[2], &m[3])) continue;
+        if (m[3] < 0) have_presented = false;
+        for (int k = 0; k < 4; k++) { if (m[k] < best[k]) best[k] = m[k]; total[k] += m[k]; }
+        runs++;
+    }
+    ctl_request(sock, "quit", reply, sizeof(reply), 500);
+    reap(pid, false);
+
+    if (!runs) { bench_skip("startup", "daemon show never committed"); return; }
+    double presented_best = have_presented ? best[3] : -1, presented_mean = have_presented ? total[3] / runs : -1;
+    TEXT("%-8s %10s %10.0f %10.0f\n", "daemon", "show us", best[0], total[0] / runs);
+    TEXT("%-8s %10s %10.0f %10.0f\n", "", "configure", best[1], total[1] / runs);
+    TEXT("%-8s %10s %10.0f %10.0f\n", "", "commit", best[2], total[2] / runs);
+    if (have_presented)
+        TEXT("%-8s %10s %10.0f %10.0f\n", "", "presented", presented_best, presented_mean);
+    bench_record("startup", "\"path\":\"daemon\",\"runs\":%d,\"show_best_us\":%.0f,\"show_mean_us\":%.0f,"
+                 "\"configure_best_us\":%.0f,\"commit_best_us\":%.0f,\"commit_mean_us\":%.0f,"
+                 "\"presented_best_us\":%.0f,\"presented_mean_us\":%.0f",
+                 runs, best[0], total[0] / runs, best[1], best[2], total[2] / runs,
+                 presented_best, presented_mean);
+}
+
+void bench_startup(int iterations, const char *overlay, const char *compositor) {
+    if (!mkdtemp(runtime_dir)) { bench_skip("startup", "no private runtime dir"); return; }
+    if (!start_compositor(compositor)) {
+        bench_skip("startup", "no compositor (try --compositor 'WLR_BACKENDS=headless sway' or 'current')");
+        reap(compositor_pid, true);
+        remove_runtime_dir();
+        return;
+    }
+
+    TEXT("Overlay startup (%s, %s)\n", compositor, getenv("WAYLAND_DISPLAY"));
+    TEXT("%-8s %10s %10s %10s\n", "path", "mark", "best us", "mean us");
+
+    double best = 1e18, total = 0, commit_best = 1e18, commit_total = 0;
+    int runs = 0;
+    for (int i = 0; i < iterations; i++) {
+        double commit = 0, wall = cold_start(overlay, &commit);
+        if (wall < 0) continue;
+        if (wall < best) best = wall;
+        if (commit < commit_best) commit_best = commit;
+        total += wall;
+        commit_total += commit;
+        runs++;
+    }
+    if (runs) {
+        TEXT("%-8s %10s %10.0f %10.0f\n", "cold", "spawn", best, total / runs);
+        TEXT("%-8s %10s %10.0f %10.0f\n", "", "commit", commit_best, commit_total / runs);
+        bench_record("startup", "\"path\":\"cold\",\"runs\":%d,\"spawn_best_us\":%.0f,\"spawn_mean_us\":%.0f,"
+                     "\"commit_best_us\":%.0f,\"commit_mean_us\":%.0f",
+                     runs, best, total / runs, commit_best, commit_total / runs);
+    } else {
+        bench_skip("startup", "cold overlay never committed");
+    }
+
+    run_daemon(iterations, overlay);
+
+    reap(compositor_pid, true);
+    remove_runtime_dir();
+}
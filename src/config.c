@@ -0,0 +1,143 @@
+/*
+ * RingLight Config - config.ini read once into a section-aware table
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pwd.h>
+
+/* The one place value ranges are defined */
+static const struct {
+    const char *key;
+    int min, max;
+} limits[] = {
+    { "width",         1,   500 },
+    { "brightness",    1,   100 },
+    { "poll_interval", 100, 60000 },
+};
+
+bool config_path(char *buf, size_t len) {
+    const char *home = getenv("HOME");
+    if (!home) {
+        struct passwd *pw = getpwuid(getuid());
+        if (pw) home = pw->pw_dir;
+    }
+    if (!home) return false;
+    int n = snprintf(buf, len, "%s/.config/ringlight/config.ini", home);
+    return n > 0 && (size_t)n < len;
+}
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return s;
+}
+
+/* Drop a " # comment" or " ; comment" after the value; a leading '#' is a color */
+static void strip_comment(char *v) {
+    for (char *p = v + 1; *p; p++) {
+        if ((*p == '#' || *p == ';') && isspace((unsigned char)p[-1])) { *p = '\0'; return; }
+    }
+}
+
+int config_load(config_t *cfg, const char *path) {
+    cfg->count = 0;
+    FILE *f = fopen(path, "re");
+    if (!f) return -1;
+
+    char line[512], section[sizeof(cfg->entries[0].section)] = "";
+    while (fgets(line, sizeof(line), f)) {
+        char *s = trim(line);
+        if (!*s || *s == '#' || *s == ';') continue;
+
+        if (*s == '[') {
+            char *end = strchr(s, ']');
+            if (!end) continue;
+            *end = '\0';
+            snprintf(section, sizeof(section), "%s", trim(s + 1));
+            continue;
+        }
+
+        char *eq = strchr(s, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        char *key = trim(s), *val = trim(eq + 1);
+        if (*val) strip_comment(val);
+        val = trim(val);
+        size_t vlen = strlen(val);
+        if (vlen >= 2 && val[0] == '"' && val[vlen - 1] == '"') { val[vlen - 1] = '\0'; val++; }
+
+        /* A repeated key overrides the earlier one */
+        config_entry_t *e = NULL;
+        for (int i = 0; i < cfg->count && !e; i++)
+            if (strcmp(cfg->entries[i].section, section) == 0 && strcmp(cfg->entries[i].key, key) == 0)
+                e = &cfg->entries[i];
+        if (!e) {
+            if (cfg->count >= CONFIG_MAX_ENTRIES) continue;
+            e = &cfg->entries[cfg->count++];
+            snprintf(e->section, sizeof(e->section), "%s", section);
+            snprintf(e->key, sizeof(e->key), "%s", key);
+        }
+        snprintf(e->value, sizeof(e->value), "%s", val);
+    }
+    fclose(f);
+    return 0;
+}
+
+const char *config_get(const config_t *cfg, const char *section, const char *key) {
+    const char *found = NULL;
+    for (int i = 0; i < cfg->count; i++) {
+        const config_entry_t *e = &cfg->entries[i];
+        if (strcmp(e->key, key) != 0) continue;
+        if (strcmp(e->section, section) == 0) return e->value;
+        if (!e->section[0]) found = e->value;
+    }
+    return found;
+}
+
+int config_int(const char *key, const char *val) {
+    int v = atoi(val);
+    for (size_t i = 0; i < sizeof(limits) / sizeof(limits[0]); i++) {
+        if (strcmp(limits[i].key, key) != 0) continue;
+        if (v < limits[i].min) v = limits[i].min;
+        if (v > limits[i].max) v = limits[i].max;
+        break;
+    }
+    return v;
+}
+
+uint32_t config_color(const char *val) {
+    return strtoul(val[0] == '#' ? val + 1 : val, NULL, 16) & 0xFFFFFF;
+}
+
+bool config_bool(const char *val) {
+    return strcmp(val, "true") == 0 || strcmp(val, "1") == 0;
+}
+
+bool config_get_int(const config_t *cfg, const char *section, const char *key, int *out) {
+    const char *v = config_get(cfg, section, key);
+    if (v) *out = config_int(key, v);
+    return v != NULL;
+}
+
+bool config_get_color(const config_t *cfg, const char *section, const char *key, uint32_t *out) {
+    const char *v = config_get(cfg, section, key);
+    if (v) *out = config_color(v);
+    return v != NULL;
+}
+
+bool config_get_bool(const config_t *cfg, const char *section, const char *key, bool *out) {
+    const char *v = config_get(cfg, section, key);
+    if (v) *out = config_bool(v);
+    return v != NULL;
+}
@@ -0,0 +1,54 @@
+/*
+ * RingLight Config - config.ini read once into a section-aware table
+ *
+ * ~/.config/ringlight/config.ini is parsed in a single pass into
+ * (section, key, value) entries. Lookups name their section; keys that
+ * appear before any [section] header, as in older configs, match every
+ * section. Values are validated by one set of rules shared by the monitor,
+ * the overlay and the overlay daemon's show/set commands.
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef RINGLIGHT_CONFIG_H
+#define RINGLIGHT_CONFIG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONFIG_MAX_ENTRIES 64
+
+typedef struct {
+    char section[16];       /* "" before the first header */
+    char key[32];
+    char value[256];
+} config_entry_t;
+
+typedef struct {
+    config_entry_t entries[CONFIG_MAX_ENTRIES];
+    int count;
+} config_t;
+
+/* $HOME/.config/ringlight/config.ini */
+bool config_path(char *buf, size_t len);
+
+/* Replace cfg with the contents of path; -1 (and an empty cfg) if unreadable */
+int config_load(config_t *cfg, const char *path);
+
+/* Raw value, or NULL if the key is not set */
+const char *config_get(const config_t *cfg, const char *section, const char *key);
+
+/* Validation: integers are clamped to the key's range, colors are RRGGBB
+ * with an optional '#', booleans are true/1 */
+int config_int(const char *key, const char *val);
+uint32_t config_color(const char *val);
+bool config_bool(const char *val);
+
+/* Typed lookups; out is left alone when the key is not set */
+bool config_get_int(const config_t *cfg, const char *section, const char *key, int *out);
+bool config_get_color(const config_t *cfg, const char *section, const char *key, uint32_t *out);
+bool config_get_bool(const config_t *cfg, const char *section, const char *key, bool *out);
+
+#endif
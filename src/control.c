@@ -0,0 +1,154 @@
+/*
+ * RingLight Control - Unix socket helpers shared by daemons and clients
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+#include "control.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+bool ctl_socket_path(const char *name, char *buf, size_t len) {
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    char fallback[64];
+    if (!dir || !*dir) {
+        snprintf(fallback, sizeof(fallback), "/run/user/%u", (unsigned)getuid());
+        dir = fallback;
+    }
+    int n = snprintf(buf, len, "%s/%s", dir, name);
+    return n > 0 && (size_t)n < len && (size_t)n < sizeof(((struct sockaddr_un *)0)->sun_path);
+}
+
+bool ctl_socket_path_uid(const char *name, uid_t uid, char *buf, size_t len) {
+    int n = snprintf(buf, len, "/run/user/%u/%s", (unsigned)uid, name);
+    return n > 0 && (size_t)n < len && (size_t)n < sizeof(((struct sockaddr_un *)0)->sun_path);
+}
+
+static bool fill_addr(struct sockaddr_un *addr, const char *path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) { errno = ENAMETOOLONG; return false; }
+    strcpy(addr->sun_path, path);
+    return true;
+}
+
+int ctl_listen(const char *path, int *lock_fd) {
+    struct sockaddr_un addr;
+    if (!fill_addr(&addr, path)) return -1;
+
+    char lock_path[PATH_MAX];
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", path);
+    int lfd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lfd < 0) return -1;
+    if (flock(lfd, LOCK_EX | LOCK_NB) < 0) {
+        close(lfd);
+        errno = EADDRINUSE;
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) { close(lfd); return -1; }
+
+    /* We hold the lock, so any socket left at path belongs to a dead daemon */
+    unlink(path);
+    mode_t old = umask(077);
+    int ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old);
+    if (ret < 0 || listen(fd, 8) < 0) {
+        int err = errno;
+        close(fd); close(lfd);
+        errno = err;
+        return -1;
+    }
+
+    *lock_fd = lfd;
+    return fd;
+}
+
+int ctl_accept(int listen_fd) {
+    int fd;
+    while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        struct ucred cred;
+        socklen_t clen = sizeof(cred);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &clen) == 0 &&
+            (cred.uid == getuid() || cred.uid == 0))
+            return fd;
+        close(fd);
+    }
+    return -1;
+}
+
+int ctl_request(const char *path, const char *cmd, char *reply, size_t len, int timeout_ms) {
+    struct sockaddr_un addr;
+    if (!fill_addr(&addr, path)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) { close(fd); return -1; }
+
+    char line[CTL_LINE_MAX];
+    int n = snprintf(line, sizeof(line), "%s\n", cmd);
+    if (n <= 0 || (size_t)n >= sizeof(line) || send(fd, line, n, MSG_NOSIGNAL) != n) {
+        close(fd);
+        return -1;
+    }
+
+    /* Read a single reply line */
+    char in[CTL_REPLY_MAX];
+    size_t got = 0;
+    while (got < sizeof(in) - 1) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (poll(&pfd, 1, timeout_ms) <= 0) break;
+        ssize_t r = recv(fd, in + got, sizeof(in) - 1 - got, 0);
+        if (r <= 0) break;
+        got += r;
+        if (memchr(in, '\n', got)) break;
+    }
+    close(fd);
+
+    in[got] = '\0';
+    char *nl = strchr(in, '\n');
+    if (!nl) return -1;
+    *nl = '\0';
+
+    if (reply && len) snprintf(reply, len, "%s", in);
+    return strncmp(in, "ok", 2) == 0 ? 0 : -1;
+}
+
+static bool session_socket(const char *name, uid_t uid, char *buf, size_t len) {
+    if (uid == getuid()) return ctl_socket_path(name, buf, len);
+    return ctl_socket_path_uid(name, uid, buf, len);
+}
+
+int ctl_trigger(uid_t uid, bool on, int hold_s, int timeout_ms) {
+    char path[PATH_MAX], cmd[64];
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    unsigned long long t0 = (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+    if (on) snprintf(cmd, sizeof(cmd), "on hold=%d t0=%llu", hold_s, t0);
+    else snprintf(cmd, sizeof(cmd), "off");
+    if (session_socket(CTL_MONITOR_SOCKET, uid, path, sizeof(path)) &&
+        ctl_request(path, cmd, NULL, 0, timeout_ms) == 0) return 0;
+
+    /* No monitor: nothing will turn it off for us if the off is lost */
+    if (on) snprintf(cmd, sizeof(cmd), "show t0=%llu", t0);
+    else snprintf(cmd, sizeof(cmd), "hide");
+    if (session_socket(CTL_OVERLAY_SOCKET, uid, path, sizeof(path)) &&
+        ctl_request(path, cmd, NULL, 0, timeout_ms) == 0) return 1;
+    return -1;
+}
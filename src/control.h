@@ -0,0 +1,59 @@
+/*
+ * RingLight Control - Unix socket helpers shared by daemons and clients
+ *
+ * Commands are single newline-terminated lines of "verb key=value ...".
+ * Every command is answered with one line starting with "ok" or "error".
+ * Commands fit in CTL_LINE_MAX; replies such as list and stats may run to
+ * CTL_REPLY_MAX.
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef RINGLIGHT_CONTROL_H
+#define RINGLIGHT_CONTROL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define CTL_OVERLAY_SOCKET "ringlight-overlay.sock"
+#define CTL_MONITOR_SOCKET "ringlight-monitor.sock"
+#define CTL_LINE_MAX 512
+#define CTL_REPLY_MAX 4096
+
+/* Build $XDG_RUNTIME_DIR/<name>, falling back to /run/user/<uid> */
+bool ctl_socket_path(const char *name, char *buf, size_t len);
+
+/* Build /run/user/<uid>/<name>, for root acting on a user's session */
+bool ctl_socket_path_uid(const char *name, uid_t uid, char *buf, size_t len);
+
+/*
+ * Bind a listening socket at path. A lock file next to the socket keeps
+ * a second daemon from stealing it; fails with EADDRINUSE if one runs.
+ * The returned lock fd must stay open for the lifetime of the daemon.
+ */
+int ctl_listen(const char *path, int *lock_fd);
+
+/*
+ * Accept the next pending client of a ctl_listen() socket, non-blocking
+ * and close-on-exec. Peers that are neither our uid nor root are closed:
+ * the socket is 0700 already, this keeps a chmod from opening it up.
+ * Returns -1 with errno EAGAIN once no connections are left.
+ */
+int ctl_accept(int listen_fd);
+
+/* Connect, send one command line and wait up to timeout_ms for the reply.
+ * Returns 0 on an "ok" reply, -1 on error replies or transport failure. */
+int ctl_request(const char *path, const char *cmd, char *reply, size_t len, int timeout_ms);
+
+/*
+ * Turn the light on or off on behalf of an authenticator. Asks the monitor
+ * first ("on hold=S" / "off"), so it can combine the request with what it
+ * detects itself, then the overlay daemon directly ("show" / "hide").
+ * Sockets are those of uid's session. Returns 0 via the monitor, 1 via the
+ * overlay daemon, -1 if neither answered.
+ */
+int ctl_trigger(uid_t uid, bool on, int hold_s, int timeout_ms);
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * RingLight Fill - Solid 32-bit pixel fill kernels for shm buffers
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "fill.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILL_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define FILL_NEON 1
+#endif
+
+#define FILL_SEED_PIXELS 1024
+
+typedef void (*fill_fn)(uint32_t *dst, uint32_t pixel, size_t count, bool stream);
+
+void fill_pixels_scalar(uint32_t *dst, uint32_t pixel, size_t count) {
+    for (size_t i = 0; i < count; i++) dst[i] = pixel;
+}
+
+static void fill_scalar(uint32_t *dst, uint32_t pixel, size_t count, bool stream) {
+    (void)stream;
+    fill_pixels_scalar(dst, pixel, count);
+}
+
+#ifdef FILL_X86
+__attribute__((target("sse2")))
+static void fill_sse2(uint32_t *dst, uint32_t pixel, size_t count, bool stream) {
+    /* Head up to 16-byte alignment for aligned/streaming stores */
+    while (count && ((uintptr_t)dst & 15)) { *dst++ = pixel; count--; }
+
+    __m128i v = _mm_set1_epi32((int)pixel);
+    size_t blocks = count / 16;
+    if (stream) {
+        for (size_t i = 0; i < blocks; i++, dst += 16) {
+            _mm_stream_si128((__m128i *)dst, v);
+            _mm_stream_si128((__m128i *)(dst + 4), v);
+            _mm_stream_si128((__m128i *)(dst + 8), v);
+            _mm_stream_si128((__m128i *)(dst + 12), v);
+        }
+        _mm_sfence();
+    } else {
+        for (size_t i = 0; i < blocks; i++, dst += 16) {
+            _mm_store_si128((__m128i *)dst, v);
+            _mm_store_si128((__m128i *)(dst + 4), v);
+            _mm_store_si128((__m128i *)(dst + 8), v);
+            _mm_store_si128((__m128i *)(dst + 12), v);
+        }
+    }
+    for (count &= 15; count; count--) *dst++ = pixel;
+}
+
+__attribute__((target("avx2")))
+static void fill_avx2(uint32_t *dst, uint32_t pixel, size_t count, bool stream) {
+    while (count && ((uintptr_t)dst & 31)) { *dst++ = pixel; count--; }
+
+    __m256i v = _mm256_set1_epi32((int)pixel);
+    size_t blocks = count / 32;
+    if (stream) {
+        for (size_t i = 0; i < blocks; i++, dst += 32) {
+            _mm256_stream_si256((__m256i *)dst, v);
+            _mm256_stream_si256((__m256i *)(dst + 8), v);
+            _mm256_stream_si256((__m256i *)(dst + 16), v);
+            _mm256_stream_si256((__m256i *)(dst + 24), v);
+        }
+        _mm_sfence();
+    } else {
+        for (size_t i = 0; i < blocks; i++, dst += 32) {
+            _mm256_store_si256((__m256i *)dst, v);
+            _mm256_store_si256((__m256i *)(dst + 8), v);
+            _mm256_store_si256((__m256i *)(dst + 16), v);
+            _mm256_store_si256((__m256i *)(dst + 24), v);
+        }
+    }
+    for (count &= 31; count; count--) *dst++ = pixel;
+}
+#endif
+
+#ifdef FILL_NEON
+static void fill_neon(uint32_t *dst, uint32_t pixel, size_t count, bool stream) {
+    /* No portable streaming store on NEON; STNP needs inline asm */
+    (void)stream;
+    uint32x4_t v = vdupq_n_u32(pixel);
+    size_t blocks = count / 16;
+    for (size_t i = 0; i < blocks; i++, dst += 16) {
+        vst1q_u32(dst, v);
+        vst1q_u32(dst + 4, v);
+        vst1q_u32(dst + 8, v);
+        vst1q_u32(dst + 12, v);
+    }
+    for (count &= 15; count; count--) *dst++ = pixel;
+}
+#endif
+
+static fill_fn kernel;
+static const char *kernel_name;
+
+static void resolve_kernel(void) {
+    kernel = fill_scalar;
+    kernel_name = "scalar";
+#ifdef FILL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) { kernel = fill_avx2; kernel_name = "avx2"; }
+    else if (__builtin_cpu_supports("sse2")) { kernel = fill_sse2; kernel_name = "sse2"; }
+#elif defined(FILL_NEON)
+    kernel = fill_neon;
+    kernel_name = "neon";
+#endif
+}
+
+void fill_pixels(uint32_t *dst, uint32_t pixel, size_t count) {
+    if (!kernel) resolve_kernel();
+    kernel(dst, pixel, count, count * 4 >= FILL_STREAM_THRESHOLD);
+}
+
+void fill_pixels_doubling(uint32_t *dst, uint32_t pixel, size_t count) {
+    if (!kernel) resolve_kernel();
+    size_t done = count < FILL_SEED_PIXELS ? count : FILL_SEED_PIXELS;
+    kernel(dst, pixel, done, false);
+    while (done < count) {
+        size_t n = done < count - done ? done : count - done;
+        memcpy(dst + done, dst, n * 4);
+        done += n;
+    }
+}
+
+const char *fill_kernel_name(void) {
+    if (!kernel) resolve_kernel();
+    return kernel_name;
+}
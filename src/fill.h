@@ -0,0 +1,33 @@
+/*
+ * RingLight Fill - Solid 32-bit pixel fill kernels for shm buffers
+ *
+ * fill_pixels() picks an SSE2/AVX2/NEON kernel at runtime and switches to
+ * non-temporal stores for large buffers, so filling pages the compositor
+ * will read does not evict our own working set.
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef RINGLIGHT_FILL_H
+#define RINGLIGHT_FILL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Buffers at least this large are written with streaming stores */
+#define FILL_STREAM_THRESHOLD (1u << 20)
+
+/* Fill count pixels at dst with the fastest kernel for this CPU */
+void fill_pixels(uint32_t *dst, uint32_t pixel, size_t count);
+
+/* Plain per-pixel loop, kept as the reference for benchmarks */
+void fill_pixels_scalar(uint32_t *dst, uint32_t pixel, size_t count);
+
+/* Fill one row-sized seed, then double it with memcpy until count is reached */
+void fill_pixels_doubling(uint32_t *dst, uint32_t pixel, size_t count);
+
+/* Name of the kernel fill_pixels() dispatches to, e.g. "avx2" */
+const char *fill_kernel_name(void);
+
+#endif
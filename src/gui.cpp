@@ -26,10 +26,23 @@
 #include <QScreen>
 #include <QSettings>
 #include <QProcess>
+#include <QLocalSocket>
 #include <QDir>
+#include <QSaveFile>
 #include <QStandardPaths>
 #include <QCloseEvent>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QPainter>
+#include <QPointer>
+#include <QQueue>
+#include <QTimer>
+
+#include <functional>
+#include <utility>
+
+#include <unistd.h>
 
 class ColorButton : public QWidget {
     Q_OBJECT
@@ -58,16 +71,86 @@ private:
     QColor m_color;
 };
 
+// Line protocol client for the overlay daemon's control socket. Commands go out on one
+// kept-open connection without blocking, and each reply is handed to its command's
+// callback in order; a daemon that is missing or stops answering fails the callback.
+class DaemonLink : public QObject {
+public:
+    using Reply = std::function<void(bool ok, const QByteArray &reply)>;
+    
+    DaemonLink(const QString &path, QObject *parent) : QObject(parent), m_path(path) {
+        connect(&m_sock, &QLocalSocket::connected, this, [this]() {
+            m_sock.write(m_outbox);
+            m_outbox.clear();
+        });
+        connect(&m_sock, &QLocalSocket::readyRead, this, &DaemonLink::readReplies);
+        connect(&m_sock, &QLocalSocket::errorOccurred, this, &DaemonLink::failAll);
+        connect(&m_sock, &QLocalSocket::disconnected, this, &DaemonLink::failAll);
+        m_timeout.setSingleShot(true);
+        connect(&m_timeout, &QTimer::timeout, this, [this]() {
+            m_sock.abort();
+            failAll();
+        });
+    }
+    
+    void send(const QString &cmd, Reply done = nullptr) {
+        QByteArray line = (cmd + "\n").toUtf8();
+        m_pending.enqueue(done);
+        if (!m_timeout.isActive()) m_timeout.start(ReplyTimeoutMs);
+        if (m_sock.state() == QLocalSocket::ConnectedState) {
+            m_sock.write(line);
+            return;
+        }
+        m_outbox += line;
+        if (m_sock.state() == QLocalSocket::UnconnectedState) m_sock.connectToServer(m_path);
+    }
+    
+    void flush(int ms) {
+        if (m_sock.state() == QLocalSocket::ConnectedState) m_sock.waitForBytesWritten(ms);
+    }
+    
+private:
+    static constexpr int ReplyTimeoutMs = 500;
+    
+    void readReplies() {
+        while (m_sock.canReadLine()) {
+            QByteArray line = m_sock.readLine().trimmed();
+            if (m_pending.isEmpty()) continue;
+            Reply done = m_pending.dequeue();
+            if (done) done(line.startsWith("ok"), line);
+        }
+        if (m_pending.isEmpty()) m_timeout.stop();
+        else m_timeout.start(ReplyTimeoutMs);
+    }
+    
+    void failAll() {
+        m_timeout.stop();
+        m_outbox.clear();
+        QQueue<Reply> pending;
+        pending.swap(m_pending);
+        for (const Reply &done : pending)
+            if (done) done(false, QByteArray());
+    }
+    
+    QString m_path;
+    QLocalSocket m_sock;
+    QTimer m_timeout;
+    QByteArray m_outbox;
+    QQueue<Reply> m_pending;
+};
+
 class RingLightGUI : public QMainWindow {
     Q_OBJECT
 public:
     RingLightGUI() {
         setWindowTitle(tr("RingLight"));
         setMinimumWidth(420);
+        m_daemon = new DaemonLink(overlaySocketPath(), this);
         setupUI();
         setupTray();
         loadSettings();
         refreshScreens();
+        ensureOverlayDaemon();
     }
     
     ~RingLightGUI() { cleanup(); }
@@ -78,16 +161,28 @@ protected:
             hide();
             e->ignore();
         } else {
-            cleanup();
             e->accept();
+            quit();
         }
     }
 
 private:
+    // Runs from quit() and again from the destructor; only the first call does anything
     void cleanup() {
+        if (m_cleanedUp) return;
+        m_cleanedUp = true;
         saveSettings();
         stopOverlay();
         stopMonitor();
+        m_daemon->flush(100);   // the hide has to leave before we exit
+    }
+    
+    // Leave once every retired child has finished, so none is left for
+    // ~QProcess to kill and wait for on the UI thread
+    void quit() {
+        cleanup();
+        m_quitting = true;
+        if (m_retiring == 0) qApp->quit();
     }
     
     void setupUI() {
@@ -113,6 +208,7 @@ private:
         m_brightnessLabel->setFixedWidth(40);
         connect(m_brightnessSlider, &QSlider::valueChanged, this, [this](int v) {
             m_brightnessLabel->setText(QString("%1%").arg(v));
+            streamStyle();
         });
         brightLay->addWidget(m_brightnessSlider);
         brightLay->addWidget(m_brightnessLabel);
@@ -128,6 +224,11 @@ private:
         m_fullscreen = new QCheckBox(tr("Fullscreen mode"));
         appearLay->addWidget(m_fullscreen, 3, 0, 1, 2);
         
+        // A shown light follows the controls as they move
+        connect(m_colorBtn, &ColorButton::colorChanged, this, [this]() { streamStyle(); });
+        connect(m_widthSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this]() { streamStyle(); });
+        connect(m_fullscreen, &QCheckBox::toggled, this, [this]() { streamStyle(); });
+        
         layout->addWidget(appearGrp);
         
         // Screens
@@ -167,6 +268,8 @@ private:
         m_modeCombo->addItem(tr("Process (no polling)"), "process");
         m_modeCombo->addItem(tr("Camera (polling)"), "camera");
         m_modeCombo->addItem(tr("Hybrid (both)"), "hybrid");
+        m_modeCombo->addItem(tr("Exec (fanotify)"), "exec-fanotify");
+        m_modeCombo->addItem(tr("Trigger (PAM/ringlight-trigger)"), "trigger");
         connect(m_modeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &RingLightGUI::onModeChanged);
         autoGrid->addWidget(m_modeCombo, 0, 1);
         
@@ -211,17 +314,15 @@ private:
         auto *saveBtn = new QPushButton(tr("Save && Apply"));
         connect(saveBtn, &QPushButton::clicked, this, [this]() {
             saveSettings();
-            if (m_autoEnable->isChecked()) {
-                stopMonitor();
+            // A running monitor picks up config.ini itself; only a new mode needs a restart
+            if (m_autoEnable->isChecked() && (!monitorRunning() || m_monitorMode != m_modeCombo->currentData().toString()))
                 startMonitor();
-            }
         });
         btnLay->addWidget(saveBtn);
         
         auto *quitBtn = new QPushButton(tr("Quit"));
         connect(quitBtn, &QPushButton::clicked, this, [this]() {
-            cleanup();
-            qApp->quit();
+            quit();
         });
         btnLay->addWidget(quitBtn);
         layout->addLayout(btnLay);
@@ -258,8 +359,7 @@ private:
         });
         menu->addSeparator();
         connect(menu->addAction(tr("Quit")), &QAction::triggered, this, [this]() {
-            cleanup();
-            qApp->quit();
+            quit();
         });
         
         m_tray->setContextMenu(menu);
@@ -283,7 +383,7 @@ private:
     void onModeChanged(int) {
         QString mode = m_modeCombo->currentData().toString();
         bool needsPoll = (mode == "camera" || mode == "hybrid");
-        bool needsProc = (mode == "process" || mode == "hybrid");
+        bool needsProc = (mode == "process" || mode == "hybrid" || mode == "exec-fanotify");
         
         m_pollLabel->setVisible(needsPoll);
         m_pollSpin->setVisible(needsPoll);
@@ -292,37 +392,102 @@ private:
         m_processEdit->setEnabled(needsProc && m_autoEnable->isChecked());
     }
     
+    // Screens are the overlay's own output inventory, keyed by connector name, so the
+    // selection means the same outputs to the overlay and the monitor. Asked of the
+    // daemon, else of a one-shot overlay; Qt's screen list is only the last resort.
     void refreshScreens() {
+        if (m_screenList->count() > 0) m_savedScreens = getEnabledScreens();
+        m_daemon->send("list", [this](bool ok, const QByteArray &reply) {
+            if (ok && setInventory(reply.mid(3))) return;
+            auto *proc = new QProcess(this);
+            connect(proc, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+                    [this, proc](int code, QProcess::ExitStatus status) {
+                bool listed = status == QProcess::NormalExit && code == 0 &&
+                              setInventory(proc->readAllStandardOutput().trimmed());
+                if (!listed) setInventory(qtInventory());
+                proc->deleteLater();
+            });
+            connect(proc, &QProcess::errorOccurred, this, [this, proc](QProcess::ProcessError err) {
+                if (err != QProcess::FailedToStart) return;
+                setInventory(qtInventory());
+                proc->deleteLater();
+            });
+            proc->start("ringlight-overlay", QStringList() << "--list" << "--json");
+        });
+    }
+    
+    static QByteArray qtInventory() {
+        QJsonArray outputs;
+        for (QScreen *scr : QGuiApplication::screens()) {
+            QJsonObject o;
+            o["name"] = scr->name();           // the wl_output name on Wayland
+            o["description"] = scr->model();
+            o["width"] = scr->size().width();
+            o["height"] = scr->size().height();
+            outputs.append(o);
+        }
+        return QJsonDocument(outputs).toJson(QJsonDocument::Compact);
+    }
+    
+    bool setInventory(const QByteArray &json) {
+        QJsonDocument doc = QJsonDocument::fromJson(json);
+        if (!doc.isArray()) return false;
+        m_outputs = doc.array();
+        
+        // Older settings hold indices in the overlay's output order
+        QStringList wanted;
+        for (const QString &s : std::as_const(m_savedScreens)) {
+            bool isIndex = false;
+            int idx = s.toInt(&isIndex);
+            if (isIndex && idx >= 0 && idx < m_outputs.size())
+                wanted << m_outputs[idx].toObject().value("name").toString();
+            else
+                wanted << s;
+        }
+        
+        bool firstOnly = wanted.isEmpty();
         m_screenList->clear();
-        const auto screens = QGuiApplication::screens();
-        for (int i = 0; i < screens.size(); ++i) {
-            QScreen *scr = screens[i];
-            QString name = QString("%1: %2 (%3x%4)")
-                .arg(i)
-                .arg(scr->name())
-                .arg(scr->size().width())
-                .arg(scr->size().height());
-            auto *item = new QListWidgetItem(name);
+        for (int i = 0; i < m_outputs.size(); ++i) {
+            const QJsonObject o = m_outputs[i].toObject();
+            QString name = o.value("name").toString();
+            QString desc = o.value("description").toString();
+            QString label = QString("%1 (%2x%3)").arg(name)
+                .arg(o.value("width").toInt()).arg(o.value("height").toInt());
+            if (!desc.isEmpty()) label += " - " + desc;
+            auto *item = new QListWidgetItem(label);
+            item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+            bool on = firstOnly ? i == 0 : wanted.contains(name);
+            item->setCheckState(on ? Qt::Checked : Qt::Unchecked);
+            item->setData(Qt::UserRole, name);
+            m_screenList->addItem(item);
+            wanted.removeAll(name);
+        }
+        // Selected but unplugged screens stay selected; the overlay lights them on return
+        for (const QString &name : std::as_const(wanted)) {
+            bool isIndex = false;
+            name.toInt(&isIndex);
+            if (isIndex) continue;
+            auto *item = new QListWidgetItem(tr("%1 (not connected)").arg(name));
             item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
-            item->setCheckState(i == 0 ? Qt::Checked : Qt::Unchecked);
-            item->setData(Qt::UserRole, i);
+            item->setCheckState(Qt::Checked);
+            item->setData(Qt::UserRole, name);
             m_screenList->addItem(item);
         }
+        return true;
     }
     
     void refreshVideoDevices() {
         m_videoDevice->clear();
+        m_videoDevice->addItem("auto");
         QDir dev("/dev");
         QStringList videos = dev.entryList(QStringList() << "video*", QDir::System);
         for (const QString &v : videos) {
             m_videoDevice->addItem("/dev/" + v);
         }
-        if (m_videoDevice->count() == 0) {
-            m_videoDevice->addItem("/dev/video0");
-        }
     }
     
     QStringList getEnabledScreens() {
+        if (m_screenList->count() == 0) return m_savedScreens;     // inventory not in yet
         QStringList screens;
         for (int i = 0; i < m_screenList->count(); ++i) {
             auto *item = m_screenList->item(i);
@@ -333,66 +498,119 @@ private:
         return screens;
     }
     
+    static constexpr int KillDeadlineMs = 2000;
+    
+    // Same rule as ctl_socket_path(), so the GUI and the daemon agree on the socket
+    static QString overlaySocketPath() {
+        QString dir = qEnvironmentVariable("XDG_RUNTIME_DIR");
+        if (dir.isEmpty()) dir = QString("/run/user/%1").arg(getuid());
+        return dir + "/ringlight-overlay.sock";
+    }
+    
+    void ensureOverlayDaemon() {
+        m_daemon->send("ping", [](bool ok, const QByteArray &) {
+            if (!ok) QProcess::startDetached("ringlight-overlay", QStringList() << "--daemon");
+        });
+    }
+    
+    QStringList styleOptions() const {
+        QStringList opts;
+        opts << "color=" + m_colorBtn->color().name().mid(1);
+        opts << "brightness=" + QString::number(m_brightnessSlider->value());
+        opts << "width=" + QString::number(m_widthSpin->value());
+        opts << QString("fullscreen=%1").arg(m_fullscreen->isChecked() ? 1 : 0);
+        return opts;
+    }
+    
+    // Restyle a shown daemon overlay; replies are not waited for and the daemon
+    // applies at most one change per frame
+    void streamStyle() {
+        if (m_daemonShown) m_daemon->send("set " + styleOptions().join(' '));
+    }
+    
     void startOverlay() {
-        stopOverlay();
-        
         QStringList screens = getEnabledScreens();
-        if (screens.isEmpty()) return;
-        
-        for (const QString &scr : screens) {
-            auto *proc = new QProcess(this);
-            QStringList args;
-            args << "-s" << scr;
-            args << "-c" << m_colorBtn->color().name().mid(1);
-            args << "-b" << QString::number(m_brightnessSlider->value());
-            args << "-w" << QString::number(m_widthSpin->value());
-            if (m_fullscreen->isChecked()) args << "-f";
-            
-            proc->start("ringlight-overlay", args);
-            m_overlayProcs.append(proc);
-        }
-        
-        m_running = true;
-        m_toggleBtn->setText(tr("Turn Off"));
-        m_toggleBtn->setStyleSheet("background-color: #c0392b; color: white; padding: 10px; font-weight: bold;");
-        if (m_toggleAction) m_toggleAction->setText(tr("Turn Off"));
+        if (screens.isEmpty()) { stopOverlay(); return; }
+        
+        setRunning(true);
+        QStringList cmd("show");
+        cmd << "screen=" + screens.join(',');
+        cmd << styleOptions();
+        m_daemon->send(cmd.join(' '), [this, screens](bool ok, const QByteArray &) {
+            if (!m_running) return;     // turned off while the show was in flight
+            if (ok) {
+                stopOverlayProcs();
+                m_daemonShown = true;
+            } else if (m_overlayProcs.isEmpty()) {
+                startOverlayProcess(screens);
+            }
+        });
     }
     
-    void stopOverlay() {
-        for (QProcess *p : m_overlayProcs) {
-            p->terminate();
-            p->waitForFinished(300);
-            if (p->state() != QProcess::NotRunning) p->kill();
-            delete p;
-        }
+    // No daemon: one overlay process drives every selected screen
+    void startOverlayProcess(const QStringList &screens) {
+        auto *proc = new QProcess(this);
+        QStringList args;
+        args << "-s" << screens.join(',');
+        args << "-c" << m_colorBtn->color().name().mid(1);
+        args << "-b" << QString::number(m_brightnessSlider->value());
+        args << "-w" << QString::number(m_widthSpin->value());
+        if (m_fullscreen->isChecked()) args << "-f";
+        
+        proc->start("ringlight-overlay", args);
+        m_overlayProcs.append(proc);
+    }
+    
+    // SIGTERM now, SIGKILL if it is still there at the deadline, deleted once it has
+    // finished; nothing waits on the UI thread and several exit in parallel
+    void retireProcess(QProcess *p) {
+        p->disconnect(this);
+        if (p->state() == QProcess::NotRunning) { p->deleteLater(); return; }
+        m_retiring++;
+        connect(p, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this, p]() {
+            p->deleteLater();
+            if (--m_retiring == 0 && m_quitting) qApp->quit();
+        });
+        QTimer::singleShot(KillDeadlineMs, p, [p]() { p->kill(); });
+        p->terminate();
+    }
+    
+    void stopOverlayProcs() {
+        for (QProcess *p : m_overlayProcs) retireProcess(p);
         m_overlayProcs.clear();
-        
-        m_running = false;
-        m_toggleBtn->setText(tr("Turn On"));
-        m_toggleBtn->setStyleSheet("background-color: #27ae60; color: white; padding: 10px; font-weight: bold;");
-        if (m_toggleAction) m_toggleAction->setText(tr("Turn On"));
+    }
+    
+    void stopOverlay() {
+        // Sent whether or not a show is still in flight; the daemon answers in order
+        if (m_daemonShown || m_running) m_daemon->send("hide");
+        m_daemonShown = false;
+        stopOverlayProcs();
+        setRunning(false);
+    }
+    
+    void setRunning(bool on) {
+        m_running = on;
+        m_toggleBtn->setText(on ? tr("Turn Off") : tr("Turn On"));
+        m_toggleBtn->setStyleSheet(on
+            ? "background-color: #c0392b; color: white; padding: 10px; font-weight: bold;"
+            : "background-color: #27ae60; color: white; padding: 10px; font-weight: bold;");
+        if (m_toggleAction) m_toggleAction->setText(on ? tr("Turn Off") : tr("Turn On"));
     }
     
     void startMonitor() {
         stopMonitor();
-        
+        // The new monitor can't take the control socket until the old one lets go
+        if (m_exitingMonitor) m_monitorStartQueued = true;
+        else launchMonitor();
+    }
+    
+    void launchMonitor() {
         m_monitorProc = new QProcess(this);
         QStringList args;
         
-        QString mode = m_modeCombo->currentData().toString();
-        args << "-m" << mode;
-        
-        if (mode == "process" || mode == "hybrid") {
-            QStringList procs = m_processEdit->text().split(',', Qt::SkipEmptyParts);
-            for (QString p : procs) {
-                args << "-p" << p.trimmed();
-            }
-        }
-        
-        if (mode == "camera" || mode == "hybrid") {
-            args << "-d" << m_videoDevice->currentText();
-            args << "-i" << QString::number(m_pollSpin->value());
-        }
+        // Everything else comes from config.ini, so later saves can be reloaded live
+        m_monitorMode = m_modeCombo->currentData().toString();
+        args << "-m" << m_monitorMode;
         
         connect(m_monitorProc, &QProcess::started, this, [this]() {
             m_monitorStatus->setText(tr("Monitor: Running"));
@@ -407,12 +625,20 @@ private:
         m_monitorProc->start("ringlight-monitor", args);
     }
     
+    bool monitorRunning() const {
+        return m_monitorProc && m_monitorProc->state() != QProcess::NotRunning;
+    }
+    
     void stopMonitor() {
+        m_monitorStartQueued = false;
         if (m_monitorProc) {
-            m_monitorProc->terminate();
-            m_monitorProc->waitForFinished(500);
-            if (m_monitorProc->state() != QProcess::NotRunning) m_monitorProc->kill();
-            delete m_monitorProc;
+            m_exitingMonitor = m_monitorProc;
+            retireProcess(m_monitorProc);
+            connect(m_exitingMonitor, &QObject::destroyed, this, [this]() {
+                if (!m_monitorStartQueued) return;
+                m_monitorStartQueued = false;
+                launchMonitor();
+            });
             m_monitorProc = nullptr;
         }
         m_monitorStatus->setText(tr("Monitor: Stopped"));
@@ -440,8 +666,8 @@ private:
         QStringList screens = getEnabledScreens();
         settings.setValue("screens", screens.join(","));
         
-        // Write config.ini for monitor daemon
-        QFile configFile(configDir + "/config.ini");
+        // Write config.ini for monitor daemon; replaced in one rename so a reload never sees half of it
+        QSaveFile configFile(configDir + "/config.ini");
         if (configFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
             QTextStream out(&configFile);
             out << "[monitor]\n";
@@ -455,7 +681,8 @@ private:
             out << "width=" << m_widthSpin->value() << "\n";
             out << "fullscreen=" << (m_fullscreen->isChecked() ? "true" : "false") << "\n";
             out << "screens=" << screens.join(",") << "\n";
-            configFile.close();
+            out.flush();
+            configFile.commit();
         }
     }
     
@@ -476,19 +703,13 @@ private:
         int modeIdx = m_modeCombo->findData(mode);
         if (modeIdx >= 0) m_modeCombo->setCurrentIndex(modeIdx);
         
-        QString videoDevice = settings.value("videoDevice", "/dev/video0").toString();
+        QString videoDevice = settings.value("videoDevice", "auto").toString();
         int vidIdx = m_videoDevice->findText(videoDevice);
         if (vidIdx >= 0) m_videoDevice->setCurrentIndex(vidIdx);
         else m_videoDevice->setCurrentText(videoDevice);
         
-        // Load screens
-        QString screenStr = settings.value("screens", "0").toString();
-        QStringList enabledScreens = screenStr.split(',', Qt::SkipEmptyParts);
-        for (int i = 0; i < m_screenList->count(); ++i) {
-            auto *item = m_screenList->item(i);
-            QString idx = item->data(Qt::UserRole).toString();
-            item->setCheckState(enabledScreens.contains(idx) ? Qt::Checked : Qt::Unchecked);
-        }
+        // Screens are applied once the inventory arrives
+        m_savedScreens = settings.value("screens", "0").toString().split(',', Qt::SkipEmptyParts);
         
         onAutoEnableToggled(m_autoEnable->isChecked());
         onModeChanged(m_modeCombo->currentIndex());
@@ -501,6 +722,8 @@ private:
     
     // UI
     QListWidget *m_screenList = nullptr;
+    QJsonArray m_outputs;           // cached output inventory
+    QStringList m_savedScreens;
     ColorButton *m_colorBtn = nullptr;
     QSlider *m_brightnessSlider = nullptr;
     QLabel *m_brightnessLabel = nullptr;
@@ -523,8 +746,16 @@ private:
     
     // State
     bool m_running = false;
+    bool m_daemonShown = false;
     QList<QProcess*> m_overlayProcs;
     QProcess *m_monitorProc = nullptr;
+    QPointer<QProcess> m_exitingMonitor;
+    bool m_monitorStartQueued = false;
+    int m_retiring = 0;                 // terminated children not yet finished
+    bool m_quitting = false;
+    bool m_cleanedUp = false;
+    QString m_monitorMode;
+    DaemonLink *m_daemon = nullptr;
 };
 
 int main(int argc, char *argv[]) {
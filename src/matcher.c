@@ -0,0 +1,236 @@
+/*
+ * RingLight Matcher - Decide whether an exec'd process is one we watch
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+#include "matcher.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* comm is at most TASK_COMM_LEN - 1 characters */
+#define COMM_MAX 16
+#define CMDLINE_MAX 1024
+#define NO_STATE UINT32_MAX
+
+struct matcher {
+    /* Exact comm names, lowercased, open addressing */
+    char (*comm)[COMM_MAX];
+    uint32_t comm_mask;
+    int comm_count;
+
+    /*
+     * Aho-Corasick DFA over the substring patterns. Bytes are folded to
+     * classes first: one per distinct pattern byte (both cases), and class
+     * 0 for everything else, which keeps each state row a few entries wide.
+     */
+    uint8_t cls[256];
+    uint32_t nclass;
+    uint32_t nstates;
+    uint32_t *delta;        /* nstates x nclass */
+    uint8_t *accept;
+};
+
+static uint32_t hash_lower(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) h = (h ^ (uint8_t)tolower((unsigned char)s[i])) * 16777619u;
+    return h;
+}
+
+static void comm_insert(matcher_t *m, const char *name, size_t len) {
+    uint32_t i = hash_lower(name, len) & m->comm_mask;
+    while (m->comm[i][0]) {
+        if (strncasecmp(m->comm[i], name, COMM_MAX) == 0) return;
+        i = (i + 1) & m->comm_mask;
+    }
+    for (size_t k = 0; k < len; k++) m->comm[i][k] = tolower((unsigned char)name[k]);
+    m->comm_count++;
+}
+
+bool matcher_match_comm(const matcher_t *m, const char *comm, size_t len) {
+    if (!m->comm_count || len == 0 || len >= COMM_MAX) return false;
+    uint32_t i = hash_lower(comm, len) & m->comm_mask;
+    while (m->comm[i][0]) {
+        if (strncasecmp(m->comm[i], comm, len) == 0 && m->comm[i][len] == '\0') return true;
+        i = (i + 1) & m->comm_mask;
+    }
+    return false;
+}
+
+bool matcher_needs_cmdline(const matcher_t *m) {
+    return m->nstates > 1;
+}
+
+bool matcher_match_cmdline(const matcher_t *m, const char *cmdline, size_t len) {
+    uint32_t s = 0;
+    for (size_t i = 0; i < len; i++) {
+        s = m->delta[s * m->nclass + m->cls[(uint8_t)cmdline[i]]];
+        if (m->accept[s]) return true;
+    }
+    return false;
+}
+
+/* Build the goto trie, then fill in failure transitions breadth-first */
+static bool build_automaton(matcher_t *m, char *const *subs, int count) {
+    size_t total = 1;
+    m->nclass = 1;
+    for (int i = 0; i < count; i++) {
+        for (const char *p = subs[i]; *p; p++, total++) {
+            uint8_t c = tolower((unsigned char)*p);
+            if (m->cls[c]) continue;
+            m->cls[c] = m->nclass;
+            m->cls[toupper(c)] = m->nclass;
+            m->nclass++;
+        }
+    }
+    /* cmdline arguments are NUL-separated; they match like spaces */
+    m->cls[0] = m->cls[' '];
+
+    m->delta = malloc(total * m->nclass * sizeof(*m->delta));
+    m->accept = calloc(total, 1);
+    uint32_t *fail = calloc(total, sizeof(*fail));
+    uint32_t *queue = malloc(total * sizeof(*queue));
+    if (!m->delta || !m->accept || !fail || !queue) { free(fail); free(queue); return false; }
+    for (size_t i = 0; i < total * m->nclass; i++) m->delta[i] = NO_STATE;
+
+    m->nstates = 1;
+    for (int i = 0; i < count; i++) {
+        uint32_t s = 0;
+        for (const char *p = subs[i]; *p; p++) {
+            uint32_t *next = &m->delta[s * m->nclass + m->cls[(uint8_t)*p]];
+            if (*next == NO_STATE) *next = m->nstates++;
+            s = *next;
+        }
+        m->accept[s] = 1;
+    }
+
+    size_t head = 0, tail = 0;
+    for (uint32_t c = 0; c < m->nclass; c++) {
+        uint32_t *v = &m->delta[c];
+        if (*v == NO_STATE) *v = 0;
+        else queue[tail++] = *v;
+    }
+    while (head < tail) {
+        uint32_t u = queue[head++];
+        m->accept[u] |= m->accept[fail[u]];
+        for (uint32_t c = 0; c < m->nclass; c++) {
+            uint32_t *v = &m->delta[u * m->nclass + c];
+            uint32_t via_fail = m->delta[fail[u] * m->nclass + c];
+            if (*v == NO_STATE) { *v = via_fail; continue; }
+            fail[*v] = via_fail;
+            queue[tail++] = *v;
+        }
+    }
+    free(fail);
+    free(queue);
+    return true;
+}
+
+matcher_t *matcher_new(char *const *patterns, int count) {
+    matcher_t *m = calloc(1, sizeof(*m));
+    char **subs = calloc(count > 0 ? count : 1, sizeof(*subs));
+    if (!m || !subs) { free(m); free(subs); return NULL; }
+
+    uint32_t cap = 8;
+    while (cap < (uint32_t)count * 2) cap <<= 1;
+    m->comm = calloc(cap, sizeof(*m->comm));
+    m->comm_mask = cap - 1;
+    if (!m->comm) { free(subs); matcher_free(m); return NULL; }
+
+    int nsubs = 0;
+    for (int i = 0; i < count; i++) {
+        const char *name = patterns[i];
+        bool comm_only = name[0] == '=';
+        if (comm_only) name++;
+        size_t len = strlen(name);
+        if (len == 0) continue;
+        if (len < COMM_MAX) comm_insert(m, name, len);
+        if (!comm_only) subs[nsubs++] = (char *)name;
+    }
+
+    bool ok = build_automaton(m, subs, nsubs);
+    free(subs);
+    if (!ok) { matcher_free(m); return NULL; }
+    return m;
+}
+
+void matcher_free(matcher_t *m) {
+    if (!m) return;
+    free(m->comm);
+    free(m->delta);
+    free(m->accept);
+    free(m);
+}
+
+static ssize_t read_proc(pid_t pid, const char *file, char *buf, size_t len) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/%s", pid, file);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, len);
+    close(fd);
+    return n;
+}
+
+bool matcher_match_pid(const matcher_t *m, pid_t pid, unsigned *reads) {
+    char comm[COMM_MAX + 1];
+    ssize_t n = read_proc(pid, "comm", comm, sizeof(comm));
+    if (reads) (*reads)++;
+    if (n > 0 && comm[n - 1] == '\n') n--;
+    if (n > 0 && matcher_match_comm(m, comm, n)) return true;
+    if (!matcher_needs_cmdline(m)) return false;
+
+    char cmdline[CMDLINE_MAX];
+    n = read_proc(pid, "cmdline", cmdline, sizeof(cmdline) - 1);
+    if (reads) (*reads)++;
+    if (n > 0 && cmdline[n - 1] == '\0') n--;     /* final terminator, not a separator */
+    return n > 0 && matcher_match_cmdline(m, cmdline, n);
+}
+
+/* Legacy path */
+static bool legacy_comm(pid_t pid, char *buf, size_t len) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    if (!fgets(buf, len, f)) { fclose(f); return false; }
+    fclose(f);
+    char *nl = strchr(buf, '\n');
+    if (nl) *nl = '\0';
+    return true;
+}
+
+static bool legacy_cmdline(pid_t pid, char *buf, size_t len) {
+    ssize_t n = read_proc(pid, "cmdline", buf, len - 1);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    for (ssize_t i = 0; i < n - 1; i++) if (buf[i] == '\0') buf[i] = ' ';
+    return true;
+}
+
+bool matcher_legacy_match_pid(char *const *patterns, int count, pid_t pid, unsigned *reads) {
+    char comm[256] = {0}, cmdline[CMDLINE_MAX] = {0};
+    bool got_comm = legacy_comm(pid, comm, sizeof(comm));
+    bool got_cmdline = legacy_cmdline(pid, cmdline, sizeof(cmdline));
+    if (reads) *reads += 2;
+
+    if (!got_comm && !got_cmdline) return false;
+
+    for (int i = 0; i < count; i++) {
+        const char *name = patterns[i];
+        bool comm_only = name[0] == '=';
+        if (comm_only) name++;
+        if (got_comm && strcasecmp(comm, name) == 0) return true;
+        if (!comm_only && got_cmdline && strcasestr(cmdline, name)) return true;
+    }
+    return false;
+}
@@ -0,0 +1,40 @@
+/*
+ * RingLight Matcher - Decide whether an exec'd process is one we watch
+ *
+ * Every watch entry matches a process whose comm equals it, or whose
+ * cmdline contains it, case-insensitively. An entry written as "=name"
+ * matches comm only. Entries are compiled once into a hash set of comm
+ * names and a single Aho-Corasick automaton over the substrings, and
+ * cmdline is only read when comm did not decide the match.
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef RINGLIGHT_MATCHER_H
+#define RINGLIGHT_MATCHER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef struct matcher matcher_t;
+
+/* Compile patterns; returns NULL on allocation failure */
+matcher_t *matcher_new(char *const *patterns, int count);
+void matcher_free(matcher_t *m);
+
+/* Read /proc/<pid>/comm and, only if needed, /proc/<pid>/cmdline; the
+ * number of files read is added to *reads unless it is NULL */
+bool matcher_match_pid(const matcher_t *m, pid_t pid, unsigned *reads);
+
+/* In-memory halves of matcher_match_pid(), for callers that have the data */
+bool matcher_match_comm(const matcher_t *m, const char *comm, size_t len);
+bool matcher_match_cmdline(const matcher_t *m, const char *cmdline, size_t len);
+bool matcher_needs_cmdline(const matcher_t *m);
+
+/* The original path: stdio comm, unconditional cmdline, a strcasecmp and
+ * strcasestr per entry. Kept to benchmark against the compiled matcher. */
+bool matcher_legacy_match_pid(char *const *patterns, int count, pid_t pid, unsigned *reads);
+
+#endif
@@ -0,0 +1,176 @@
+/*
+ * RingLight Metrics - Counters and latency histograms for the monitor
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+#include "metrics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#define PREFIX "ringlight_monitor_"
+
+_Atomic uint64_t metrics_counters[M_COUNTERS];
+metrics_hist_t metrics_hists[M_HISTOGRAMS];
+
+static const struct { const char *name, *help; } counter_info[M_COUNTERS] = {
+    [M_PROC_EVENTS]       = { "proc_events",       "Proc connector messages handled" },
+    [M_EXEC_EVENTS]       = { "exec_events",       "Exec events from netlink or fanotify" },
+    [M_EXIT_EVENTS]       = { "exit_events",       "Exit events from netlink" },
+    [M_NETLINK_BATCHES]   = { "netlink_batches",   "recvmmsg calls that returned messages" },
+    [M_NETLINK_OVERFLOWS] = { "netlink_overflows", "Netlink receive buffer overflows (ENOBUFS)" },
+    [M_FANOTIFY_EVENTS]   = { "fanotify_events",   "fanotify events read" },
+    [M_PROC_LOOKUPS]      = { "proc_lookups",      "Processes checked against the watch list" },
+    [M_PROC_READS]        = { "proc_reads",        "Files read from /proc to match processes" },
+    [M_MATCHES]           = { "matches",           "Processes that matched the watch list" },
+    [M_RESYNCS]           = { "resyncs",           "Full /proc rescans" },
+    [M_RESYNC_SCANNED]    = { "resync_scanned",    "Processes visited by rescans" },
+    [M_CAMERA_PROBES]     = { "camera_probes",     "V4L2 streaming probes" },
+    [M_OVERLAY_STARTS]    = { "overlay_starts",    "Times the light was turned on" },
+    [M_OVERLAY_SPAWNS]    = { "overlay_spawns",    "Standalone overlay processes spawned" },
+    [M_OVERLAY_STOPS]     = { "overlay_stops",     "Times the light was turned off" },
+    [M_DAEMON_ERRORS]     = { "daemon_errors",     "Overlay daemon commands that failed" },
+    [M_CONTROL_COMMANDS]  = { "control_commands",  "Commands on the control socket" },
+    [M_CONFIG_RELOADS]    = { "config_reloads",    "config.ini reloads" },
+    [M_WAKEUPS]           = { "wakeups",           "Event loop wakeups" },
+};
+
+static const struct { const char *name, *help; } hist_info[M_HISTOGRAMS] = {
+    [H_NETLINK_DRAIN] = { "netlink_drain", "Time to handle one netlink wakeup" },
+    [H_MATCH]         = { "match",         "Time to check one process against the watch list" },
+    [H_RESYNC]        = { "resync",        "Time for one /proc rescan" },
+    [H_OVERLAY_START] = { "overlay_start", "Time spent turning the light on" },
+    [H_ACTIVATION]    = { "activation",    "Event to the overlay's first presented frame" },
+};
+
+static struct timespec started;
+
+void metrics_init(void) {
+    clock_gettime(CLOCK_MONOTONIC, &started);
+}
+
+void metrics_observe(metric_hist_t h, uint64_t us) {
+    /* Bucket b holds up to 2^b us, as Prometheus' le="2^b" counts */
+    int b = us > 1 ? 64 - __builtin_clzll(us - 1) : 0;
+    if (b >= METRICS_BUCKETS) b = METRICS_BUCKETS - 1;
+    atomic_fetch_add_explicit(&metrics_hists[h].buckets[b], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&metrics_hists[h].sum_us, us, memory_order_relaxed);
+}
+
+/* Upper bound in us of bucket b; the last bucket has none */
+static uint64_t bucket_le(int b) {
+    return b < METRICS_BUCKETS - 1 ? (uint64_t)1 << b : UINT64_MAX;
+}
+
+static void snapshot(metric_hist_t h, uint64_t *buckets, uint64_t *count) {
+    *count = 0;
+    for (int b = 0; b < METRICS_BUCKETS; b++) {
+        buckets[b] = atomic_load_explicit(&metrics_hists[h].buckets[b], memory_order_relaxed);
+        *count += buckets[b];
+    }
+}
+
+/* Bucket bound at quantile q, in us; 0 without samples, UINT64_MAX past the last bound */
+static uint64_t quantile(const uint64_t *buckets, uint64_t count, double q) {
+    if (!count) return 0;
+    uint64_t want = (uint64_t)(q * count + 0.5), seen = 0;
+    if (want < 1) want = 1;
+    for (int b = 0; b < METRICS_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= want) return bucket_le(b);
+    }
+    return bucket_le(METRICS_BUCKETS - 1);
+}
+
+typedef struct {
+    double uptime_s, user_s, sys_s;
+    long maxrss_kb;
+} process_t;
+
+static void process_gauges(process_t *p) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    p->uptime_s = (now.tv_sec - started.tv_sec) + (now.tv_nsec - started.tv_nsec) / 1e9;
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    p->user_s = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+    p->sys_s = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    p->maxrss_kb = ru.ru_maxrss;
+}
+
+bool metrics_format(char *buf, size_t len) {
+    size_t pos = 0;
+#define APPEND(...) do { if (pos < len) pos += snprintf(buf + pos, len - pos, __VA_ARGS__); } while (0)
+    process_t p;
+    process_gauges(&p);
+    APPEND("uptime_s=%.0f cpu_user_ms=%.0f cpu_sys_ms=%.0f maxrss_kb=%ld",
+           p.uptime_s, p.user_s * 1e3, p.sys_s * 1e3, p.maxrss_kb);
+    for (int c = 0; c < M_COUNTERS; c++)
+        APPEND(" %s=%llu", counter_info[c].name, (unsigned long long)metrics_get(c));
+    for (int h = 0; h < M_HISTOGRAMS; h++) {
+        uint64_t buckets[METRICS_BUCKETS], count;
+        snapshot(h, buckets, &count);
+        unsigned long long sum = atomic_load_explicit(&metrics_hists[h].sum_us, memory_order_relaxed);
+        APPEND(" %s_count=%llu %s_sum_us=%llu", hist_info[h].name, (unsigned long long)count,
+               hist_info[h].name, sum);
+        static const int percentiles[] = { 50, 99 };
+        for (int i = 0; i < 2; i++) {
+            uint64_t q = quantile(buckets, count, percentiles[i] / 100.0);
+            if (q == UINT64_MAX) APPEND(" %s_p%d_us=+Inf", hist_info[h].name, percentiles[i]);
+            else APPEND(" %s_p%d_us=%llu", hist_info[h].name, percentiles[i], (unsigned long long)q);
+        }
+    }
+#undef APPEND
+    return pos < len;
+}
+
+int metrics_write_textfile(const char *path) {
+    char tmp[PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, getpid()) >= (int)sizeof(tmp)) return -1;
+    FILE *f = fopen(tmp, "we");
+    if (!f) return -1;
+
+    process_t p;
+    process_gauges(&p);
+    fprintf(f, "# HELP " PREFIX "uptime_seconds Time since the monitor started\n"
+               "# TYPE " PREFIX "uptime_seconds gauge\n" PREFIX "uptime_seconds %.3f\n", p.uptime_s);
+    fprintf(f, "# HELP " PREFIX "cpu_seconds_total CPU time used by the monitor\n"
+               "# TYPE " PREFIX "cpu_seconds_total counter\n"
+               PREFIX "cpu_seconds_total{mode=\"user\"} %.3f\n"
+               PREFIX "cpu_seconds_total{mode=\"system\"} %.3f\n", p.user_s, p.sys_s);
+    fprintf(f, "# HELP " PREFIX "max_rss_bytes Peak resident set size\n"
+               "# TYPE " PREFIX "max_rss_bytes gauge\n" PREFIX "max_rss_bytes %ld\n", p.maxrss_kb * 1024);
+
+    for (int c = 0; c < M_COUNTERS; c++)
+        fprintf(f, "# HELP " PREFIX "%s_total %s\n# TYPE " PREFIX "%s_total counter\n" PREFIX "%s_total %llu\n",
+                counter_info[c].name, counter_info[c].help, counter_info[c].name, counter_info[c].name,
+                (unsigned long long)metrics_get(c));
+
+    for (int h = 0; h < M_HISTOGRAMS; h++) {
+        const char *name = hist_info[h].name;
+        uint64_t buckets[METRICS_BUCKETS], count, cum = 0;
+        snapshot(h, buckets, &count);
+        fprintf(f, "# HELP " PREFIX "%s_seconds %s\n# TYPE " PREFIX "%s_seconds histogram\n",
+                name, hist_info[h].help, name);
+        for (int b = 0; b < METRICS_BUCKETS - 1; b++) {
+            cum += buckets[b];
+            fprintf(f, PREFIX "%s_seconds_bucket{le=\"%.6f\"} %llu\n",
+                    name, bucket_le(b) / 1e6, (unsigned long long)cum);
+        }
+        fprintf(f, PREFIX "%s_seconds_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)count);
+        fprintf(f, PREFIX "%s_seconds_sum %.6f\n", name,
+                atomic_load_explicit(&metrics_hists[h].sum_us, memory_order_relaxed) / 1e6);
+        fprintf(f, PREFIX "%s_seconds_count %llu\n", name, (unsigned long long)count);
+    }
+
+    if (fclose(f) != 0 || rename(tmp, path) < 0) { unlink(tmp); return -1; }
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * RingLight Metrics - Counters and latency histograms for the monitor
+ *
+ * Counters are relaxed C11 atomics, so bumping one on a hot path is a
+ * single lock-free add and a reader never blocks the event loop.
+ * Histograms count microsecond latencies in power-of-two buckets: bucket
+ * i holds values up to 2^i us, and the last one everything longer, so a
+ * quantile that lands there is reported as +Inf rather than a bound.
+ *
+ * The same numbers are served two ways: one "key=value ..." line for the
+ * control socket's stats command, and the Prometheus text format for the
+ * node-exporter textfile collector.
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef RINGLIGHT_METRICS_H
+#define RINGLIGHT_METRICS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    M_PROC_EVENTS,          /* proc connector messages handled */
+    M_EXEC_EVENTS,
+    M_EXIT_EVENTS,
+    M_NETLINK_BATCHES,      /* recvmmsg calls that returned messages */
+    M_NETLINK_OVERFLOWS,    /* ENOBUFS */
+    M_FANOTIFY_EVENTS,
+    M_PROC_LOOKUPS,         /* processes checked against the watch list */
+    M_PROC_READS,           /* /proc files read doing so */
+    M_MATCHES,
+    M_RESYNCS,
+    M_RESYNC_SCANNED,
+    M_CAMERA_PROBES,
+    M_OVERLAY_STARTS,
+    M_OVERLAY_SPAWNS,       /* standalone overlay processes, no daemon */
+    M_OVERLAY_STOPS,
+    M_DAEMON_ERRORS,
+    M_CONTROL_COMMANDS,
+    M_CONFIG_RELOADS,
+    M_WAKEUPS,
+    M_COUNTERS
+} metric_counter_t;
+
+typedef enum {
+    H_NETLINK_DRAIN,        /* one netlink wakeup, every message in it */
+    H_MATCH,                /* one process against the watch list */
+    H_RESYNC,
+    H_OVERLAY_START,
+    H_ACTIVATION,           /* event to first presented frame, when the daemon reports it */
+    M_HISTOGRAMS
+} metric_hist_t;
+
+#define METRICS_BUCKETS 24
+
+typedef struct {
+    _Atomic uint64_t buckets[METRICS_BUCKETS];
+    _Atomic uint64_t sum_us;
+} metrics_hist_t;
+
+extern _Atomic uint64_t metrics_counters[M_COUNTERS];
+extern metrics_hist_t metrics_hists[M_HISTOGRAMS];
+
+static inline void metrics_add(metric_counter_t c, uint64_t n) {
+    atomic_fetch_add_explicit(&metrics_counters[c], n, memory_order_relaxed);
+}
+
+static inline void metrics_inc(metric_counter_t c) {
+    metrics_add(c, 1);
+}
+
+static inline uint64_t metrics_get(metric_counter_t c) {
+    return atomic_load_explicit(&metrics_counters[c], memory_order_relaxed);
+}
+
+void metrics_observe(metric_hist_t h, uint64_t us);
+
+/* Start of the uptime gauge */
+void metrics_init(void);
+
+/* Counters, histogram count/sum/p50/p99 and process gauges as one line of
+ * key=value pairs; false if it didn't fit */
+bool metrics_format(char *buf, size_t len);
+
+/* Prometheus text format, written next to path and renamed over it */
+int metrics_write_textfile(const char *path);
+
+#endif
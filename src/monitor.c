@@ -2,7 +2,10 @@
  * RingLight Monitor - Event-driven webcam activity detector
  *
  * Watches for specific processes (like howdy) via netlink proc connector,
- * or polls for camera activity via V4L2, and launches the overlay.
+ * or watches every V4L2 capture node (with uevent hotplug), and launches the overlay.
+ * The overlay is driven through the ringlight-overlay daemon's control
+ * socket when it is running, falling back to a standalone overlay process.
+ * Authenticators can also switch it directly over the monitor's own socket.
  *
  * Copyright (C) 2024-2025 Bryan
  * SPDX-License-Identifier: GPL-3.0-or-later
@@ -18,30 +21,59 @@
 #include <errno.h>
 #include <getopt.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <ctype.h>
+#include <dirent.h>
 #include <sys/wait.h>
+#include <spawn.h>
+#include <sys/syscall.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <sys/ioctl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/fanotify.h>
+#include <arpa/inet.h>
+#include <linux/filter.h>
 #include <linux/netlink.h>
 #include <linux/connector.h>
 #include <linux/cn_proc.h>
 #include <linux/videodev2.h>
 #include <limits.h>
-#include <pwd.h>
-#include <poll.h>
+#include <time.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+#include "config.h"
+#include "control.h"
+#include "matcher.h"
+#include "metrics.h"
+#include "pidset.h"
 
 #define MAX_ITEMS 16
 
-enum monitor_mode { MODE_PROCESS, MODE_CAMERA, MODE_HYBRID };
+/* Netlink receive: datagrams per recvmmsg call, bytes per datagram, socket buffer */
+#define NL_BATCH 16
+#define NL_BUF_SIZE 8192
+#define NL_RCVBUF (1 << 20)
 
-static volatile sig_atomic_t running = 1;
-static pid_t overlay_pids[MAX_ITEMS];
-static int overlay_count = 0;
+enum monitor_mode { MODE_PROCESS, MODE_CAMERA, MODE_HYBRID, MODE_EXEC_FANOTIFY, MODE_TRIGGER };
+static const char *const mode_names[] = { "process", "camera", "hybrid", "exec-fanotify", "trigger" };
+
+static bool running = true;
+static char overlay_sock[PATH_MAX];
+static bool overlay_via_daemon = false;
 static bool verbose = false;
 
 /* Configuration */
 static enum monitor_mode mode = MODE_PROCESS;
-static char video_dev[256] = "/dev/video0";
+static char video_dev[256] = "auto";
 static char color[32] = "FFFFFF";
 static int brightness = 100, width = 80;
 static int poll_interval_ms = 2000;
@@ -50,18 +82,185 @@ static char *watch_procs[MAX_ITEMS];
 static int watch_proc_count = 0;
 static char *screens[MAX_ITEMS];
 static int screen_count = 0;
+static bool use_legacy_matcher = false;
+static const char *matcher_opt = NULL;      /* -M, which wins over the file */
+static char metrics_file[PATH_MAX] = "";    /* node-exporter textfile, if set */
+static matcher_t *matcher = NULL;
+
+/*
+ * Settings before the config file is applied: the defaults above plus the
+ * command line. Every load starts again from here, so a key deleted from
+ * the file falls back as it would at startup.
+ */
+static struct {
+    enum monitor_mode mode;
+    char video_dev[sizeof(video_dev)];
+    char color[sizeof(color)];
+    int brightness, width, poll_interval_ms;
+    bool fullscreen;
+    int proc_count;
+    char metrics_file[sizeof(metrics_file)];
+} base;
 
 /* Runtime state */
 static int nl_sock = -1;
-static pid_t watched_pids[MAX_ITEMS];
-static int watched_pid_count = 0;
+static int fan_fd = -1;                     /* mode=exec-fanotify */
+static pidset_t watched;                    /* fd is -1 where only netlink reports the exit */
 static bool overlay_active = false;
+static bool trigger_held = false;           /* an authenticator asked for the light */
+static int config_inotify = -1;             /* config.ini's directory, for reloads */
+
+static double resync_last_ms = 0;
+
+/*
+ * Activation trace: microsecond CLOCK_MONOTONIC marks from the triggering
+ * event to the overlay's first presented frame, kept for the last few
+ * activations and dumped on SIGUSR1.
+ */
+#define TRACE_DEPTH 16
 
-static void sig_handler(int s) { (void)s; running = 0; }
+typedef struct {
+    uint64_t event, match, command;           /* monitor side */
+    uint64_t configure, commit, presented;    /* reported by the overlay daemon, 0 if unknown */
+} trace_t;
+
+static trace_t traces[TRACE_DEPTH];
+static unsigned trace_count = 0;
+static trace_t *cur_trace = NULL;
+static uint64_t event_us = 0;                 /* receipt time of the event being handled */
 
 #define log_info(...) do { if (verbose) fprintf(stderr, "[ringlight] " __VA_ARGS__); } while(0)
 #define log_err(...) fprintf(stderr, "[ringlight] " __VA_ARGS__)
 
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Open a trace record for an activation caused by the current event */
+static void trace_begin(void) {
+    cur_trace = &traces[trace_count++ % TRACE_DEPTH];
+    *cur_trace = (trace_t){ .event = event_us ? event_us : now_us(), .match = now_us() };
+}
+
+/*
+ * Reactor
+ *
+ * Every mode runs the same loop: one epoll set of event sources, each an
+ * fd with a callback, and a mode is just the set of sources it registers.
+ * Timers are timerfds registered the same way and are only armed while
+ * something is waiting on them, so an idle monitor sleeps in epoll_wait
+ * until the kernel has news. Sources are indexed by fd, which the kernel
+ * keeps dense, so adding and removing one is O(1) however many pidfds
+ * are being tracked.
+ */
+#define REACTOR_BATCH 32
+
+typedef void (*source_fn)(int fd, void *ctx);
+
+typedef struct {
+    uint32_t gen;       /* bumped on every add, so events queued for a reused fd are dropped */
+    source_fn fn;       /* NULL while the fd is not registered */
+    void *ctx;
+} source_t;
+
+typedef struct {
+    int fd;
+    bool armed;
+    void (*fire)(void);
+} reactor_timer_t;
+
+static int epfd = -1;
+static source_t *sources = NULL;
+static int source_cap = 0;
+static sigset_t orig_sigmask;       /* handed to children at spawn */
+static sigset_t sig_mask;           /* what signal_fd reads */
+static int signal_fd = -1;
+
+static bool reactor_add(int fd, source_fn fn, void *ctx) {
+    if (fd < 0 || epfd < 0) return false;
+    if (fd >= source_cap) {
+        int cap = source_cap ? source_cap : 32;
+        while (cap <= fd) cap *= 2;
+        source_t *grown = realloc(sources, cap * sizeof(*sources));
+        if (!grown) { log_err("Out of memory watching fd %d\n", fd); return false; }
+        memset(grown + source_cap, 0, (cap - source_cap) * sizeof(*sources));
+        sources = grown;
+        source_cap = cap;
+    }
+
+    source_t *src = &sources[fd];
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = (uint64_t)(src->gen + 1) << 32 | (uint32_t)fd };
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        log_err("epoll add fd %d: %s\n", fd, strerror(errno));
+        return false;
+    }
+    *src = (source_t){ .gen = src->gen + 1, .fn = fn, .ctx = ctx };
+    return true;
+}
+
+/* Call before closing fd; events already fetched for it are discarded */
+static void reactor_remove(int fd) {
+    if (fd < 0 || fd >= source_cap || !sources[fd].fn) return;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    sources[fd].fn = NULL;
+}
+
+static void timer_expired(int fd, void *ctx) {
+    reactor_timer_t *t = ctx;
+    uint64_t ticks;
+    if (read(fd, &ticks, sizeof(ticks)) != sizeof(ticks)) return;
+    if (t->armed && t->fire) t->fire();
+}
+
+static void timer_init(reactor_timer_t *t, void (*fire)(void)) {
+    *t = (reactor_timer_t){ .fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC), .fire = fire };
+    if (t->fd < 0) { log_err("timerfd: %s\n", strerror(errno)); return; }
+    if (!reactor_add(t->fd, timer_expired, t)) { close(t->fd); t->fd = -1; }
+}
+
+/* Fire after ms, then every ms if periodic; ms == 0 disarms */
+static void timer_arm(reactor_timer_t *t, int ms, bool periodic) {
+    if (t->fd < 0) return;
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000 };
+    struct itimerspec its = { .it_value = ts };
+    if (periodic) its.it_interval = ts;
+    timerfd_settime(t->fd, 0, &its, NULL);
+    t->armed = ms > 0;
+}
+
+static int reactor_init(void) {
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) log_err("epoll: %s\n", strerror(errno));
+    return epfd;
+}
+
+static void reactor_run(void) {
+    struct epoll_event evs[REACTOR_BATCH];
+    while (running) {
+        int n = epoll_wait(epfd, evs, REACTOR_BATCH, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            log_err("epoll_wait: %s\n", strerror(errno));
+            break;
+        }
+        metrics_inc(M_WAKEUPS);
+        for (int i = 0; i < n && running; i++) {
+            int fd = (uint32_t)evs[i].data.u64;
+            source_t *src = &sources[fd];
+            if (!src->fn || src->gen != evs[i].data.u64 >> 32) continue;
+            src->fn(fd, src->ctx);
+        }
+    }
+}
+
+static int source_count(void) {
+    int n = 0;
+    for (int i = 0; i < source_cap; i++) n += sources[i].fn != NULL;
+    return n;
+}
+
 static char *trim(char *s) {
     while (*s && isspace(*s)) s++;
     if (!*s) return s;
@@ -83,98 +282,263 @@ static void parse_list(const char *str, char **arr, int *cnt, int max) {
     free(copy);
 }
 
-static void load_config(void) {
-    const char *home = getenv("HOME");
-    if (!home) { struct passwd *pw = getpwuid(getuid()); if (pw) home = pw->pw_dir; }
-    if (!home) return;
+/* Inverse of parse_list; false if the result did not fit */
+static bool join_list(char *const *arr, int cnt, char *buf, size_t len) {
+    size_t n = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < cnt; i++) {
+        int w = snprintf(buf + n, len - n, "%s%s", i ? "," : "", arr[i]);
+        if (w < 0 || (size_t)w >= len - n) return false;
+        n += w;
+    }
+    return true;
+}
+
+static bool parse_mode(const char *name, enum monitor_mode *out) {
+    for (size_t i = 0; i < sizeof(mode_names) / sizeof(mode_names[0]); i++)
+        if (strcmp(name, mode_names[i]) == 0) { *out = i; return true; }
+    return false;
+}
 
+/* First executable called name on PATH, written to out */
+static bool find_in_path(const char *name, char *out, size_t len) {
+    const char *path = getenv("PATH");
+    if (!path || !*path) path = "/usr/local/bin:/usr/bin:/bin";
+    for (const char *p = path; *p; ) {
+        const char *end = strchrnul(p, ':');
+        int n = end - p;
+        snprintf(out, len, "%.*s/%s", n ? n : 1, n ? p : ".", name);
+        if (access(out, X_OK) == 0) return true;
+        p = *end ? end + 1 : end;
+    }
+    out[0] = '\0';
+    return false;
+}
+
+static void read_config_file(void) {
+    static config_t cfg;
     char path[PATH_MAX];
-    snprintf(path, sizeof(path), "%s/.config/ringlight/config.ini", home);
+    if (!config_path(path, sizeof(path)) || config_load(&cfg, path) < 0) return;
 
-    FILE *f = fopen(path, "r");
-    if (!f) return;
+    const char *v;
+    if ((v = config_get(&cfg, "monitor", "mode"))) parse_mode(v, &mode);
+    if ((v = config_get(&cfg, "monitor", "watch_processes"))) parse_list(v, watch_procs, &watch_proc_count, MAX_ITEMS);
+    if ((v = config_get(&cfg, "monitor", "matcher"))) use_legacy_matcher = strcmp(v, "legacy") == 0;
+    if ((v = config_get(&cfg, "monitor", "video_device"))) snprintf(video_dev, sizeof(video_dev), "%s", v);
+    config_get_int(&cfg, "monitor", "poll_interval", &poll_interval_ms);
+    if ((v = config_get(&cfg, "monitor", "metrics_file"))) snprintf(metrics_file, sizeof(metrics_file), "%s", v);
 
-    char line[512];
-    while (fgets(line, sizeof(line), f)) {
-        if (line[0] == '#' || line[0] == ';' || line[0] == '[') continue;
-        char *eq = strchr(line, '=');
-        if (!eq) continue;
+    uint32_t rgb;
+    if (config_get_color(&cfg, "overlay", "color", &rgb)) snprintf(color, sizeof(color), "%06X", rgb);
+    config_get_int(&cfg, "overlay", "brightness", &brightness);
+    config_get_int(&cfg, "overlay", "width", &width);
+    config_get_bool(&cfg, "overlay", "fullscreen", &fullscreen);
+    if ((v = config_get(&cfg, "overlay", "screens"))) parse_list(v, screens, &screen_count, MAX_ITEMS);
+}
 
-        *eq = '\0';
-        char *key = trim(line);
-        char *val = trim(eq + 1);
+/*
+ * Files behind the watch entries, for mode=exec-fanotify: an entry with a
+ * slash is a path, a bare name is looked up on PATH. Anything that is not
+ * ELF is treated as a script that an interpreter may open rather than exec.
+ */
+typedef struct {
+    char path[PATH_MAX];
+    bool script;
+} exec_target_t;
+
+static exec_target_t exec_targets[MAX_ITEMS];
+static int exec_target_count = 0;
 
-        if (strcmp(key, "mode") == 0) {
-            if (strcmp(val, "process") == 0) mode = MODE_PROCESS;
-            else if (strcmp(val, "camera") == 0) mode = MODE_CAMERA;
-            else if (strcmp(val, "hybrid") == 0) mode = MODE_HYBRID;
+static void resolve_exec_targets(void) {
+    exec_target_count = 0;
+    for (int i = 0; i < watch_proc_count; i++) {
+        const char *name = watch_procs[i][0] == '=' ? watch_procs[i] + 1 : watch_procs[i];
+        exec_target_t *t = &exec_targets[exec_target_count];
+        if (strchr(name, '/')) {
+            if (!realpath(name, t->path)) continue;
+        } else {
+            char found[PATH_MAX];
+            if (!find_in_path(name, found, sizeof(found)) || !realpath(found, t->path)) continue;
         }
-        else if (strcmp(key, "color") == 0) strncpy(color, val[0] == '#' ? val+1 : val, sizeof(color)-1);
-        else if (strcmp(key, "brightness") == 0) { brightness = atoi(val); if (brightness < 1) brightness = 1; if (brightness > 100) brightness = 100; }
-        else if (strcmp(key, "width") == 0) { width = atoi(val); if (width < 10) width = 10; if (width > 500) width = 500; }
-        else if (strcmp(key, "fullscreen") == 0) fullscreen = (strcmp(val, "true") == 0 || strcmp(val, "1") == 0);
-        else if (strcmp(key, "video_device") == 0) strncpy(video_dev, val, sizeof(video_dev)-1);
-        else if (strcmp(key, "poll_interval") == 0) { poll_interval_ms = atoi(val); if (poll_interval_ms < 100) poll_interval_ms = 100; }
-        else if (strcmp(key, "screens") == 0) parse_list(val, screens, &screen_count, MAX_ITEMS);
-        else if (strcmp(key, "watch_processes") == 0) parse_list(val, watch_procs, &watch_proc_count, MAX_ITEMS);
+
+        char magic[4] = {0};
+        int fd = open(t->path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        ssize_t n = read(fd, magic, sizeof(magic));
+        close(fd);
+        t->script = n < 4 || memcmp(magic, "\177ELF", 4) != 0;
+        exec_target_count++;
     }
-    fclose(f);
 }
 
-static bool get_proc_comm(pid_t pid, char *buf, size_t len) {
-    char path[64];
-    snprintf(path, sizeof(path), "/proc/%d/comm", pid);
-    FILE *f = fopen(path, "r");
-    if (!f) return false;
-    if (!fgets(buf, len, f)) { fclose(f); return false; }
-    fclose(f);
-    char *nl = strchr(buf, '\n');
-    if (nl) *nl = '\0';
-    return true;
+static void save_base(void) {
+    base.mode = mode;
+    memcpy(base.video_dev, video_dev, sizeof(video_dev));
+    memcpy(base.color, color, sizeof(color));
+    base.brightness = brightness;
+    base.width = width;
+    base.poll_interval_ms = poll_interval_ms;
+    base.fullscreen = fullscreen;
+    base.proc_count = watch_proc_count;
+    memcpy(base.metrics_file, metrics_file, sizeof(metrics_file));
 }
 
-static bool get_proc_cmdline(pid_t pid, char *buf, size_t len) {
-    char path[64];
-    snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
-    int fd = open(path, O_RDONLY);
-    if (fd < 0) return false;
-    ssize_t n = read(fd, buf, len - 1);
-    close(fd);
-    if (n <= 0) return false;
-    buf[n] = '\0';
-    for (ssize_t i = 0; i < n - 1; i++) if (buf[i] == '\0') buf[i] = ' ';
-    return true;
+static void restore_base(void) {
+    mode = base.mode;
+    memcpy(video_dev, base.video_dev, sizeof(video_dev));
+    memcpy(color, base.color, sizeof(color));
+    brightness = base.brightness;
+    width = base.width;
+    poll_interval_ms = base.poll_interval_ms;
+    fullscreen = base.fullscreen;
+    memcpy(metrics_file, base.metrics_file, sizeof(metrics_file));
+    use_legacy_matcher = false;
+    for (int i = base.proc_count; i < watch_proc_count; i++) free(watch_procs[i]);
+    watch_proc_count = base.proc_count;
+    for (int i = 0; i < screen_count; i++) free(screens[i]);
+    screen_count = 0;
+}
+
+static void load_config(void) {
+    restore_base();
+    read_config_file();
+    if (matcher_opt) use_legacy_matcher = strcmp(matcher_opt, "legacy") == 0;
+    if (watch_proc_count == 0) watch_procs[watch_proc_count++] = strdup("howdy");
+    resolve_exec_targets();
+
+    matcher_free(matcher);
+    matcher = matcher_new(watch_procs, watch_proc_count);
+    if (!matcher) log_err("Failed to compile watch list, using legacy matcher\n");
 }
 
 static bool matches_watch_list(pid_t pid) {
-    char comm[256] = {0}, cmdline[1024] = {0};
-    bool got_comm = get_proc_comm(pid, comm, sizeof(comm));
-    bool got_cmdline = get_proc_cmdline(pid, cmdline, sizeof(cmdline));
+    uint64_t t0 = now_us();
+    unsigned reads = 0;
+    bool hit = use_legacy_matcher || !matcher
+        ? matcher_legacy_match_pid(watch_procs, watch_proc_count, pid, &reads)
+        : matcher_match_pid(matcher, pid, &reads);
+    metrics_observe(H_MATCH, now_us() - t0);
+    metrics_inc(M_PROC_LOOKUPS);
+    metrics_add(M_PROC_READS, reads);
+    if (hit) metrics_inc(M_MATCHES);
+    return hit;
+}
 
-    if (!got_comm && !got_cmdline) return false;
+/*
+ * Kernel-side event filter
+ *
+ * A classic BPF program on nl_sock passes every exec event but only the
+ * exit events of tracked pids, so busy machines don't wake us for each
+ * fork and exit. Pids with a pidfd report their exit through it and are
+ * left out. Loads are big-endian, hence the htonl() constants. Past
+ * NL_FILTER_MAX_PIDS such pids all exits are passed instead.
+ */
+#define NL_FILTER_MAX_PIDS 64
+#define NL_EVENT_OFF (NLMSG_LENGTH(0) + offsetof(struct cn_msg, data))
+#define NL_WHAT_OFF (NL_EVENT_OFF + offsetof(struct proc_event, what))
+#define NL_EXIT_PID_OFF (NL_EVENT_OFF + offsetof(struct proc_event, event_data.exit.process_pid))
 
-    for (int i = 0; i < watch_proc_count; i++) {
-        if (got_comm && strcasecmp(comm, watch_procs[i]) == 0) return true;
-        if (got_cmdline && strcasestr(cmdline, watch_procs[i])) return true;
+static void update_netlink_filter(void) {
+    if (nl_sock < 0) return;
+
+    int k = 0;
+    for (uint32_t i = 0; i < watched.cap; i++) if (watched.slots[i].pid && watched.slots[i].fd < 0) k++;
+    bool all_exits = k > NL_FILTER_MAX_PIDS;
+    if (all_exits) k = 0;
+    int drop = 3 + (all_exits ? 0 : 1 + k), accept = drop + 1;
+
+    struct sock_filter code[5 + NL_FILTER_MAX_PIDS];
+    int n = 0;
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, NL_WHAT_OFF);
+    code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(PROC_EVENT_EXEC), accept - 2, 0);
+    code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(PROC_EVENT_EXIT),
+                                             all_exits ? accept - 3 : 0, drop - 3);
+    if (!all_exits) {
+        code[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, NL_EXIT_PID_OFF);
+        for (uint32_t i = 0; i < watched.cap; i++) {
+            const pidset_entry_t *e = &watched.slots[i];
+            if (!e->pid || e->fd >= 0) continue;
+            code[n] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl((uint32_t)e->pid), accept - n - 1, 0);
+            n++;
+        }
     }
-    return false;
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF);
+
+    struct sock_fprog prog = { .len = n, .filter = code };
+    if (setsockopt(nl_sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0)
+        log_err("Netlink filter failed, receiving all events: %s\n", strerror(errno));
 }
 
-static void add_watched_pid(pid_t pid) {
-    if (watched_pid_count >= MAX_ITEMS) return;
-    for (int i = 0; i < watched_pid_count; i++) if (watched_pids[i] == pid) return;
-    watched_pids[watched_pid_count++] = pid;
-    log_info("Tracking pid %d\n", pid);
+/*
+ * Exit tracking
+ *
+ * Each tracked pid is held by a pidfd that polls readable the moment the
+ * process exits, immune to pid reuse. Kernels without pidfd_open (< 5.3)
+ * leave the pidfd at -1 and the exit arrives as a netlink event instead.
+ */
+static bool have_pidfd = true;
+
+/* -1 with errno set on failure; ESRCH means the process is gone */
+static int open_pidfd(pid_t pid) {
+    if (!have_pidfd) { errno = ENOSYS; return -1; }
+    int fd = syscall(SYS_pidfd_open, pid, 0);
+    if (fd < 0 && errno == ENOSYS) {
+        log_info("pidfd_open unavailable, falling back to netlink and SIGCHLD\n");
+        have_pidfd = false;
+        errno = ENOSYS;
+    }
+    if (fd >= 0) fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
 }
 
-static void remove_watched_pid(pid_t pid) {
-    for (int i = 0; i < watched_pid_count; i++) {
-        if (watched_pids[i] == pid) {
-            watched_pids[i] = watched_pids[--watched_pid_count];
-            log_info("Untracked pid %d\n", pid);
-            return;
-        }
+static void watched_pid_exited(pid_t pid);
+
+static void pidfd_ready(int fd, void *ctx) {
+    (void)fd;
+    pid_t pid = (pid_t)(intptr_t)ctx;
+    log_info("Process exited: pid %d\n", pid);
+    watched_pid_exited(pid);
+}
+
+/* Returns false if the process is already gone */
+static bool track_pid(pid_t pid) {
+    if (pidset_find(&watched, pid)) return true;
+
+    int fd = open_pidfd(pid);
+    if (fd < 0 && errno == ESRCH) return false;
+    if (fd >= 0 && !reactor_add(fd, pidfd_ready, (void *)(intptr_t)pid)) { close(fd); fd = -1; }
+    if (!pidset_insert(&watched, pid, fd)) {
+        log_err("Out of memory tracking pid %d\n", pid);
+        if (fd >= 0) { reactor_remove(fd); close(fd); }
+        return true;
+    }
+    log_info("Tracking pid %d%s\n", pid, fd >= 0 ? " (pidfd)" : "");
+    return true;
+}
+
+static void clear_watched_pids(void) {
+    for (uint32_t i = 0; i < watched.cap; i++) {
+        int fd = watched.slots[i].fd;
+        if (!watched.slots[i].pid || fd < 0) continue;
+        reactor_remove(fd);
+        close(fd);
     }
+    pidset_clear(&watched);
+}
+
+static bool add_watched_pid(pid_t pid) {
+    if (!track_pid(pid)) return false;
+    update_netlink_filter();
+    return true;
+}
+
+static void remove_watched_pid(pid_t pid) {
+    int fd;
+    if (!pidset_remove(&watched, pid, &fd)) return;
+    log_info("Untracked pid %d\n", pid);
+    if (fd >= 0) { reactor_remove(fd); close(fd); }
+    else update_netlink_filter();
 }
 
 static int setup_netlink(void) {
@@ -191,6 +555,14 @@ static int setup_netlink(void) {
         return -1;
     }
 
+    /* Room for exec storms; FORCE lifts rmem_max since we hold CAP_NET_ADMIN */
+    int rcvbuf = NL_RCVBUF;
+    if (setsockopt(nl_sock, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0)
+        setsockopt(nl_sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    /* Filter before subscribing so the first events are already trimmed */
+    update_netlink_filter();
+
     struct {
         struct nlmsghdr nl;
         struct cn_msg cn;
@@ -210,9 +582,38 @@ static int setup_netlink(void) {
     return 0;
 }
 
-static bool v4l2_streaming(void) {
-    int fd = open(video_dev, O_RDONLY | O_NONBLOCK);
+/*
+ * Camera watch
+ *
+ * video_device is "auto" - every V4L2 capture node, following hotplug -
+ * or a comma-separated list of paths. inotify IN_OPEN/IN_CLOSE on each
+ * node counts how many other processes hold it open. Only while that
+ * count is non-zero is the REQBUFS probe run (every poll_interval, to see
+ * streaming start or stop); an idle camera costs nothing. The probe's own
+ * open/close shows up in the same event stream and is subtracted. fanotify
+ * would name the opener but needs CAP_SYS_ADMIN, so it is not used here.
+ */
+#define MAX_CAMERAS 16
+#define UEVENT_GROUPS 3         /* kernel (1) and udev (2) multicast groups */
+#define UDEV_MONITOR_MAGIC 0xfeedcafe
+
+typedef struct {
+    char path[64];
+    int wd;                         /* inotify watch, -1 while the node is missing */
+    int opens;                      /* opens held by other processes */
+    int self_opens, self_closes;    /* probe events still to be ignored */
+    bool streaming;
+} camera_t;
+
+static camera_t cameras[MAX_CAMERAS];
+static int camera_count = 0;
+static bool cameras_auto = false;
+static int cam_inotify = -1, uevent_sock = -1;
+
+static bool v4l2_streaming(camera_t *cam) {
+    int fd = open(cam->path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
     if (fd < 0) return false;
+    if (cam->wd >= 0) { cam->self_opens++; cam->self_closes++; }
     struct v4l2_requestbuffers req = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE, .memory = V4L2_MEMORY_MMAP };
     int ret = ioctl(fd, VIDIOC_REQBUFS, &req);
     int err = errno;
@@ -220,162 +621,1426 @@ static bool v4l2_streaming(void) {
     return (ret < 0 && err == EBUSY);
 }
 
-static void start_overlay(void) {
-    if (overlay_active) return;
-    log_info("Starting overlay\n");
+/* UVC cameras expose a metadata node next to each capture node; skip those */
+static bool is_capture_device(const char *path) {
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct v4l2_capability cap;
+    bool ok = ioctl(fd, VIDIOC_QUERYCAP, &cap) == 0;
+    close(fd);
+    if (!ok) return false;
+    uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+    return caps & (V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_VIDEO_CAPTURE_MPLANE);
+}
 
-    char bstr[16], wstr[16], sstr[16];
-    snprintf(bstr, sizeof(bstr), "%d", brightness);
-    snprintf(wstr, sizeof(wstr), "%d", width);
+static camera_t *find_camera(const char *path) {
+    for (int i = 0; i < camera_count; i++)
+        if (strcmp(cameras[i].path, path) == 0) return &cameras[i];
+    return NULL;
+}
+
+static void camera_watch(camera_t *cam) {
+    cam->wd = cam_inotify >= 0 ? inotify_add_watch(cam_inotify, cam->path, IN_OPEN | IN_CLOSE) : -1;
+    cam->opens = cam->self_opens = cam->self_closes = 0;
+    cam->streaming = false;
+    if (cam->wd >= 0) log_info("Watching %s\n", cam->path);
+}
+
+static void camera_unwatch(camera_t *cam) {
+    if (cam->wd >= 0) inotify_rm_watch(cam_inotify, cam->wd);
+    cam->wd = -1;
+    cam->opens = 0;
+    cam->streaming = false;
+}
+
+static void add_camera(const char *path) {
+    if (find_camera(path) || camera_count >= MAX_CAMERAS) return;
+    /* Query before watching so the check isn't counted as an open */
+    if (cameras_auto && !is_capture_device(path)) { log_info("Skipping %s, not a capture node\n", path); return; }
+    camera_t *cam = &cameras[camera_count++];
+    memset(cam, 0, sizeof(*cam));
+    snprintf(cam->path, sizeof(cam->path), "%s", path);
+    camera_watch(cam);
+}
+
+static void remove_camera(camera_t *cam) {
+    log_info("Dropping %s\n", cam->path);
+    camera_unwatch(cam);
+    *cam = cameras[--camera_count];
+}
+
+static void setup_hotplug(void) {
+    uevent_sock = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (uevent_sock < 0) { log_err("No uevent socket, cameras won't follow hotplug\n"); return; }
+    struct sockaddr_nl addr = { .nl_family = AF_NETLINK, .nl_groups = UEVENT_GROUPS };
+    int on = 1;
+    if (bind(uevent_sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        setsockopt(uevent_sock, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on)) < 0) {
+        log_err("uevent bind failed: %s\n", strerror(errno));
+        close(uevent_sock);
+        uevent_sock = -1;
+    }
+}
+
+/*
+ * Bring the camera set in line with video_dev. Cameras in both the old
+ * and the new set keep their watch and open count; auto keeps every
+ * camera it already has and adds any capture node missing.
+ */
+static void sync_cameras(void) {
+    cameras_auto = strcmp(video_dev, "auto") == 0;
+    if (cameras_auto) {
+        DIR *dir = opendir("/dev");
+        struct dirent *d;
+        while (dir && (d = readdir(dir))) {
+            if (strncmp(d->d_name, "video", 5) != 0 || strlen(d->d_name) > 32) continue;
+            char path[48];
+            snprintf(path, sizeof(path), "/dev/%s", d->d_name);
+            add_camera(path);
+        }
+        if (dir) closedir(dir);
+        return;
+    }
+
+    char *list[MAX_CAMERAS];
+    int count = 0;
+    parse_list(video_dev, list, &count, MAX_CAMERAS);
+    for (int i = camera_count - 1; i >= 0; i--) {
+        bool listed = false;
+        for (int j = 0; j < count && !listed; j++) listed = strcmp(cameras[i].path, list[j]) == 0;
+        if (!listed) remove_camera(&cameras[i]);
+    }
+    for (int i = 0; i < count; i++) { add_camera(list[i]); free(list[i]); }
+}
+
+static void setup_camera_watch(void) {
+    cam_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (cam_inotify < 0) log_err("inotify unavailable, polling cameras: %s\n", strerror(errno));
+    setup_hotplug();
+    sync_cameras();
+    log_info("Cameras: %d (%s)\n", camera_count, cameras_auto ? "auto" : video_dev);
+}
+
+/* Fold queued open/close events into each camera; true if anyone else acted */
+static bool drain_camera_events(void) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool foreign = false;
+    ssize_t n;
+    while ((n = read(cam_inotify, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            camera_t *cam = NULL;
+            for (int i = 0; i < camera_count && !cam; i++)
+                if (cameras[i].wd == ev->wd) cam = &cameras[i];
+            if (!cam) continue;
 
-    int num = screen_count > 0 ? screen_count : 1;
-    overlay_count = 0;
-
-    for (int i = 0; i < num && overlay_count < MAX_ITEMS; i++) {
-        pid_t pid = fork();
-        if (pid == 0) {
-            char *args[16];
-            int n = 0;
-            args[n++] = (char*)"ringlight-overlay";
-            args[n++] = (char*)"-c"; args[n++] = color;
-            args[n++] = (char*)"-b"; args[n++] = bstr;
-            args[n++] = (char*)"-w"; args[n++] = wstr;
-            if (fullscreen) args[n++] = (char*)"-f";
-            if (screen_count > 0) {
-                snprintf(sstr, sizeof(sstr), "%s", screens[i]);
-                args[n++] = (char*)"-s";
-                args[n++] = sstr;
+            if (ev->mask & IN_OPEN) {
+                if (cam->self_opens > 0) cam->self_opens--;
+                else { cam->opens++; foreign = true; }
+            }
+            if (ev->mask & IN_CLOSE) {
+                if (cam->self_closes > 0) cam->self_closes--;
+                else { if (cam->opens > 0) cam->opens--; foreign = true; }
+            }
+            if (ev->mask & IN_IGNORED) {
+                log_info("%s went away\n", cam->path);
+                cam->wd = -1;
+                cam->opens = 0;
+                cam->streaming = false;
+                foreign = true;
             }
-            args[n] = NULL;
-            execvp("ringlight-overlay", args);
-            _exit(1);
-        } else if (pid > 0) {
-            overlay_pids[overlay_count++] = pid;
         }
     }
-    overlay_active = (overlay_count > 0);
+    return foreign;
+}
+
+/* Property block of a kernel ("add@/devices/...") or udev ("libudev") uevent */
+static const char *uevent_props(const char *buf, size_t *len) {
+    struct {
+        char prefix[8];
+        uint32_t magic, header_size, properties_off, properties_len;
+    } hdr;
+    if (*len >= sizeof(hdr) && memcmp(buf, "libudev", 8) == 0) {
+        memcpy(&hdr, buf, sizeof(hdr));
+        if (ntohl(hdr.magic) != UDEV_MONITOR_MAGIC || hdr.properties_off >= *len) return NULL;
+        if (hdr.properties_len < *len - hdr.properties_off) *len = hdr.properties_off + hdr.properties_len;
+        return buf + hdr.properties_off;
+    }
+    size_t head = strnlen(buf, *len) + 1;
+    return head < *len ? buf + head : NULL;
+}
+
+/* Returns true when the camera set changed */
+static bool handle_uevent(const char *buf, size_t len) {
+    const char *p = uevent_props(buf, &len), *end = buf + len;
+    const char *action = NULL, *subsystem = NULL, *devname = NULL;
+    for (; p && p < end; p += strnlen(p, end - p) + 1) {
+        if (strncmp(p, "ACTION=", 7) == 0) action = p + 7;
+        else if (strncmp(p, "SUBSYSTEM=", 10) == 0) subsystem = p + 10;
+        else if (strncmp(p, "DEVNAME=", 8) == 0) devname = p + 8;
+    }
+    if (!action || !devname || !subsystem || strcmp(subsystem, "video4linux") != 0) return false;
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s%s", devname[0] == '/' ? "" : "/dev/", devname);
+    camera_t *cam = find_camera(path);
+
+    /* The kernel's add can beat the device node; udev's repeat catches up */
+    if (strcmp(action, "add") == 0) {
+        if (cameras_auto && !cam) { add_camera(path); return find_camera(path) != NULL; }
+        if (cam && cam->wd < 0) { camera_watch(cam); return true; }
+    } else if (strcmp(action, "remove") == 0 && cam) {
+        if (cameras_auto) remove_camera(cam);
+        else camera_unwatch(cam);
+        return true;
+    }
+    return false;
+}
+
+static bool drain_hotplug(void) {
+    char buf[8192];
+    char ctrl[CMSG_SPACE(sizeof(struct ucred))];
+    bool changed = false;
+    for (;;) {
+        struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) - 1 };
+        struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = ctrl, .msg_controllen = sizeof(ctrl) };
+        ssize_t n = recvmsg(uevent_sock, &msg, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        /* Only the kernel and root's udevd get to add devices */
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (!cmsg || cmsg->cmsg_type != SCM_CREDENTIALS || ((struct ucred *)CMSG_DATA(cmsg))->uid != 0) continue;
+        buf[n] = '\0';
+        if (handle_uevent(buf, n)) changed = true;
+    }
+    return changed;
+}
+
+/* -1 while every camera is idle and watched; otherwise the probe interval */
+static int camera_timeout(void) {
+    if (cam_inotify < 0) return poll_interval_ms;
+    for (int i = 0; i < camera_count; i++) {
+        if (cameras[i].opens > 0) return poll_interval_ms;
+        if (cameras[i].wd < 0 && uevent_sock < 0) return poll_interval_ms;
+    }
+    return -1;
+}
+
+static bool probe_cameras(void) {
+    bool any = false;
+    for (int i = 0; i < camera_count; i++) {
+        camera_t *cam = &cameras[i];
+        if (cam->wd < 0 && cam_inotify >= 0) camera_watch(cam);
+        if (cam->wd >= 0 && cam->opens == 0) { cam->streaming = false; continue; }
+        cam->streaming = v4l2_streaming(cam);
+        metrics_inc(M_CAMERA_PROBES);
+        any |= cam->streaming;
+    }
+    return any;
+}
+
+/*
+ * Overlay children
+ *
+ * Overlays are started with posix_spawn (vfork semantics, so nothing of
+ * our image is copied) from a path resolved on PATH once and cached.
+ * Nothing here waits: stopping signals every lit child at once, each
+ * child's pidfd reaps it from the reactor, and a kill timer escalates to
+ * SIGKILL for any still alive after OVERLAY_KILL_MS. Without pidfds the
+ * reaping rides on SIGCHLD through the signalfd instead.
+ */
+#define OVERLAY_KILL_MS 2000
+
+typedef struct {
+    pid_t pid;
+    int pidfd;              /* -1 when reaped on SIGCHLD */
+    bool detached;          /* the daemon: reaped if it dies, never stopped */
+    bool terminating;
+    uint64_t kill_at;       /* SIGKILL deadline once terminating */
+} child_t;
+
+static child_t children[MAX_ITEMS];
+static int child_count = 0;
+static char overlay_path[PATH_MAX];
+static reactor_timer_t kill_timer;
+
+extern char **environ;
+
+static bool resolve_overlay(void) {
+    if (overlay_path[0]) return true;
+    if (find_in_path("ringlight-overlay", overlay_path, sizeof(overlay_path))) {
+        log_info("Overlay: %s\n", overlay_path);
+        return true;
+    }
+    log_err("ringlight-overlay not found in PATH\n");
+    return false;
+}
+
+static void remove_child(int i) {
+    if (children[i].pidfd >= 0) { reactor_remove(children[i].pidfd); close(children[i].pidfd); }
+    children[i] = children[--child_count];
+}
+
+/* Arm for the nearest SIGKILL deadline, or disarm when nobody is terminating */
+static void arm_kill_timer(void) {
+    uint64_t next = 0;
+    for (int i = 0; i < child_count; i++)
+        if (children[i].terminating && children[i].kill_at != UINT64_MAX && (!next || children[i].kill_at < next))
+            next = children[i].kill_at;
+    if (!next) { if (kill_timer.armed) timer_arm(&kill_timer, 0, false); return; }
+    uint64_t now = now_us();
+    timer_arm(&kill_timer, next > now + 1000 ? (int)((next - now) / 1000) : 1, false);
+}
+
+/* Collect pid if it has exited; returns true when it was reaped */
+static bool reap_child(pid_t pid) {
+    int status;
+    if (waitpid(pid, &status, WNOHANG) != pid) return false;
+    for (int i = 0; i < child_count; i++) {
+        if (children[i].pid != pid) continue;
+        if (WIFSIGNALED(status)) log_info("Overlay %d killed by signal %d\n", pid, WTERMSIG(status));
+        else log_info("Overlay %d exited (%d)\n", pid, WEXITSTATUS(status));
+        remove_child(i);
+        break;
+    }
+
+    arm_kill_timer();
+    return true;
+}
+
+static void child_ready(int fd, void *ctx) {
+    (void)fd;
+    reap_child((pid_t)(intptr_t)ctx);
+}
+
+/* SIGCHLD path for children without a pidfd */
+static void reap_children(void) {
+    for (int i = child_count - 1; i >= 0; i--)
+        if (i < child_count && children[i].pidfd < 0) reap_child(children[i].pid);
+}
+
+static void watch_sigchld(void) {
+    if (sigismember(&sig_mask, SIGCHLD)) return;
+    sigaddset(&sig_mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &sig_mask, NULL);
+    signalfd(signal_fd, &sig_mask, 0);
+}
+
+static pid_t spawn_child(char *const argv[], bool detached) {
+    if (child_count >= MAX_ITEMS || !resolve_overlay()) return -1;
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    short flags = POSIX_SPAWN_SETSIGMASK;
+#ifdef POSIX_SPAWN_SETSID
+    if (detached) flags |= POSIX_SPAWN_SETSID;
+#endif
+    posix_spawnattr_setflags(&attr, flags);
+    posix_spawnattr_setsigmask(&attr, &orig_sigmask);
+
+    pid_t pid;
+    int err = posix_spawn(&pid, overlay_path, NULL, &attr, argv, environ);
+    if (err == ENOENT) {
+        /* Reinstalled somewhere else since we looked */
+        overlay_path[0] = '\0';
+        if (resolve_overlay()) err = posix_spawn(&pid, overlay_path, NULL, &attr, argv, environ);
+    }
+    posix_spawnattr_destroy(&attr);
+    if (err) {
+        log_err("Cannot start %s: %s\n", overlay_path[0] ? overlay_path : "ringlight-overlay", strerror(err));
+        return -1;
+    }
+
+    child_t *c = &children[child_count++];
+    *c = (child_t){ .pid = pid, .pidfd = open_pidfd(pid), .detached = detached };
+    if (c->pidfd >= 0 && !reactor_add(c->pidfd, child_ready, (void *)(intptr_t)pid)) {
+        close(c->pidfd);
+        c->pidfd = -1;
+    }
+    if (c->pidfd < 0) {
+        watch_sigchld();
+        reap_child(pid);        /* may have died before SIGCHLD was routed to us */
+    }
+    return pid;
+}
+
+/* SIGTERM every lit overlay at once; the reactor reaps them */
+static void terminate_children(void) {
+    uint64_t deadline = now_us() + OVERLAY_KILL_MS * 1000ull;
+    for (int i = 0; i < child_count; i++) {
+        child_t *c = &children[i];
+        if (c->detached || c->terminating) continue;
+        kill(c->pid, SIGTERM);
+        c->terminating = true;
+        c->kill_at = deadline;
+    }
+    arm_kill_timer();
+}
+
+static void kill_expired(void) {
+    kill_timer.armed = false;
+    uint64_t now = now_us();
+    for (int i = 0; i < child_count; i++) {
+        child_t *c = &children[i];
+        if (!c->terminating || c->kill_at > now) continue;
+        log_err("Overlay %d ignored SIGTERM, killing\n", c->pid);
+        kill(c->pid, SIGKILL);
+        c->kill_at = UINT64_MAX;    /* reaped when the pidfd fires */
+    }
+    arm_kill_timer();
+}
+
+/* At exit there is no loop left to reap for us: wait out the deadline, then kill */
+static void reap_children_at_exit(void) {
+    uint64_t deadline = now_us() + OVERLAY_KILL_MS * 1000ull;
+    for (;;) {
+        bool pending = false;
+        for (int i = child_count - 1; i >= 0; i--) {
+            if (!children[i].terminating) continue;
+            if (!reap_child(children[i].pid)) pending = true;
+        }
+        if (!pending) return;
+        if (now_us() >= deadline) break;
+        usleep(10000);
+    }
+    for (int i = 0; i < child_count; i++) {
+        if (!children[i].terminating) continue;
+        kill(children[i].pid, SIGKILL);
+        waitpid(children[i].pid, NULL, 0);
+    }
+}
+
+/*
+ * Overlay daemon link
+ *
+ * Commands to ringlight-overlay --daemon go out on one kept-open,
+ * non-blocking connection that the reactor reads replies from; the daemon
+ * answers in order, so each reply belongs to the oldest command still
+ * queued. Nothing waits for an answer: DAEMON_REPLY_MS without one drops
+ * the connection and fails everything queued, and a failed show falls back
+ * to a standalone overlay from there. A slow or hung daemon costs a late
+ * light, never stalled event handling.
+ */
+#define DAEMON_REPLY_MS 500
+#define DAEMON_QUEUE 16
+
+enum daemon_verb { D_PING, D_SHOW, D_SET, D_HIDE, D_TRACE };
+
+typedef struct {
+    enum daemon_verb verb;
+    unsigned show;          /* show: which start_overlay() sent it */
+    trace_t *trace;         /* trace: record to fill in */
+    bool dump;              /* trace: print the traces once it is in */
+    uint64_t sent;
+} daemon_cmd_t;
+
+static int daemon_fd = -1;
+static char daemon_buf[CTL_REPLY_MAX];
+static size_t daemon_len;
+static daemon_cmd_t daemon_queue[DAEMON_QUEUE];
+static unsigned daemon_head, daemon_count;
+static unsigned show_seq;
+static reactor_timer_t daemon_timer;
+
+static void daemon_reply(const daemon_cmd_t *c, bool ok, const char *line);
+
+static void daemon_disconnect(void) {
+    if (daemon_fd < 0) return;
+    reactor_remove(daemon_fd);
+    close(daemon_fd);
+    daemon_fd = -1;
+    daemon_len = 0;
+}
+
+/* Replies handed on may queue new commands; they start a fresh connection */
+static void daemon_fail_all(void) {
+    daemon_disconnect();
+    if (daemon_timer.armed) timer_arm(&daemon_timer, 0, false);
+    unsigned n = daemon_count;
+    daemon_cmd_t failed[DAEMON_QUEUE];
+    for (unsigned i = 0; i < n; i++) failed[i] = daemon_queue[(daemon_head + i) % DAEMON_QUEUE];
+    daemon_head = daemon_count = 0;
+    for (unsigned i = 0; i < n; i++) daemon_reply(&failed[i], false, NULL);
+}
+
+static void daemon_expired(void) {
+    daemon_timer.armed = false;
+    log_err("Overlay daemon did not answer within %dms\n", DAEMON_REPLY_MS);
+    daemon_fail_all();
+}
+
+static void daemon_ready(int fd, void *ctx) {
+    (void)ctx;
+    for (;;) {
+        ssize_t n = read(fd, daemon_buf + daemon_len, sizeof(daemon_buf) - 1 - daemon_len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) { daemon_fail_all(); return; }
+        daemon_len += n;
+
+        char *start = daemon_buf, *nl;
+        while ((nl = memchr(start, '\n', daemon_buf + daemon_len - start))) {
+            *nl = '\0';
+            if (daemon_count) {
+                daemon_cmd_t c = daemon_queue[daemon_head];
+                daemon_head = (daemon_head + 1) % DAEMON_QUEUE;
+                daemon_count--;
+                daemon_reply(&c, strncmp(start, "ok", 2) == 0, start);
+                /* A reply handler can drop the connection */
+                if (daemon_fd != fd) return;
+            }
+            start = nl + 1;
+        }
+        daemon_len -= start - daemon_buf;
+        memmove(daemon_buf, start, daemon_len);
+        if (daemon_len == sizeof(daemon_buf) - 1) { daemon_fail_all(); return; }
+    }
+    if (daemon_count) timer_arm(&daemon_timer, DAEMON_REPLY_MS, false);
+    else if (daemon_timer.armed) timer_arm(&daemon_timer, 0, false);
+}
+
+/* A Unix socket connects at once or not at all, so this never waits */
+static bool daemon_connect(void) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(overlay_sock) >= sizeof(addr.sun_path)) return false;
+    strcpy(addr.sun_path, overlay_sock);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || !reactor_add(fd, daemon_ready, NULL)) {
+        close(fd);
+        return false;
+    }
+    daemon_fd = fd;
+    daemon_len = 0;
+    return true;
+}
+
+/* Queue cmd; false when it cannot go out, the caller's failure to handle */
+static bool daemon_send(const char *line, daemon_cmd_t c) {
+    if (!overlay_sock[0] || daemon_count == DAEMON_QUEUE) return false;
+    if (daemon_fd < 0 && !daemon_connect()) return false;
+
+    char buf[CTL_LINE_MAX + 1];
+    int n = snprintf(buf, sizeof(buf), "%s\n", line);
+    if (n <= 0 || (size_t)n >= sizeof(buf)) return false;
+    /* Lines are tiny next to the socket buffer; a short write means the daemon stopped reading */
+    if (send(daemon_fd, buf, n, MSG_NOSIGNAL | MSG_DONTWAIT) != n) {
+        daemon_fail_all();
+        return false;
+    }
+    c.sent = now_us();
+    daemon_queue[(daemon_head + daemon_count++) % DAEMON_QUEUE] = c;
+    if (!daemon_timer.armed) timer_arm(&daemon_timer, DAEMON_REPLY_MS, false);
+    return true;
+}
+
+static void spawn_daemon_process(void) {
+    char *args[] = { (char *)"ringlight-overlay", (char *)"--daemon", NULL };
+    pid_t pid = spawn_child(args, true);
+    if (pid > 0) log_info("Spawned overlay daemon (pid %d)\n", pid);
+}
+
+/* Launch the overlay daemon unless one already answers; it outlives us */
+static void spawn_overlay_daemon(void) {
+    timer_init(&daemon_timer, daemon_expired);
+    if (!ctl_socket_path(CTL_OVERLAY_SOCKET, overlay_sock, sizeof(overlay_sock))) {
+        overlay_sock[0] = '\0';
+        return;
+    }
+    if (!daemon_send("ping", (daemon_cmd_t){ .verb = D_PING })) spawn_daemon_process();
+}
+
+/* The style options shared by show and set */
+static bool overlay_options(char *buf, size_t len) {
+    char list[256];
+    if (!join_list(screens, screen_count, list, sizeof(list))) return false;
+    int n = snprintf(buf, len, "color=%s brightness=%d width=%d fullscreen=%d%s%s",
+                     color, brightness, width, fullscreen ? 1 : 0, screen_count ? " screen=" : "", list);
+    return n > 0 && (size_t)n < len;
+}
+
+static bool daemon_style(const char *verb, uint64_t t0, daemon_cmd_t c) {
+    char opts[CTL_LINE_MAX], cmd[CTL_LINE_MAX];
+    if (!overlay_options(opts, sizeof(opts))) return false;
+    int n = t0 ? snprintf(cmd, sizeof(cmd), "%s %s t0=%llu", verb, opts, (unsigned long long)t0)
+               : snprintf(cmd, sizeof(cmd), "%s %s", verb, opts);
+    if (n <= 0 || (size_t)n >= sizeof(cmd)) return false;
+    return daemon_send(cmd, c);
+}
+
+static bool daemon_show(void) {
+    return daemon_style("show", cur_trace ? cur_trace->event : now_us(),
+                        (daemon_cmd_t){ .verb = D_SHOW, .show = ++show_seq });
+}
+
+/* Ask for the overlay's marks for the latest show; the reply fills in t */
+static bool trace_fetch(trace_t *t, bool dump) {
+    return t && daemon_send("trace", (daemon_cmd_t){ .verb = D_TRACE, .trace = t, .dump = dump });
+}
+
+static void trace_store(trace_t *t, const char *reply) {
+    unsigned long long t0, cfg, commit, presented;
+    if (sscanf(reply, "ok t0=%llu configure=%llu commit=%llu presented=%llu",
+               &t0, &cfg, &commit, &presented) != 4 || t0 != t->event) return;
+    if (presented && !t->presented) metrics_observe(H_ACTIVATION, presented - t->event);
+    t->configure = cfg;
+    t->commit = commit;
+    t->presented = presented;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Mark relative to the triggering event, -1 when it was never reached */
+static long long trace_rel(const trace_t *t, uint64_t mark) {
+    return mark ? (long long)(mark - t->event) : -1;
+}
+
+static void print_traces(void) {
+    unsigned n = trace_count < TRACE_DEPTH ? trace_count : TRACE_DEPTH;
+    log_err("trace: %u activation(s), us after event\n", n);
+    log_err("  %8s %8s %9s %8s %9s\n", "match", "command", "configure", "commit", "presented");
+
+    uint64_t lat[TRACE_DEPTH];
+    unsigned nlat = 0;
+    for (unsigned i = 0; i < n; i++) {
+        trace_t *t = &traces[(trace_count - n + i) % TRACE_DEPTH];
+        log_err("  %8lld %8lld %9lld %8lld %9lld\n", trace_rel(t, t->match), trace_rel(t, t->command),
+                trace_rel(t, t->configure), trace_rel(t, t->commit), trace_rel(t, t->presented));
+        if (t->presented) lat[nlat++] = t->presented - t->event;
+    }
+    if (nlat) {
+        qsort(lat, nlat, sizeof(lat[0]), cmp_u64);
+        log_err("event->presented: min %llu median %llu max %llu us\n",
+                (unsigned long long)lat[0], (unsigned long long)lat[nlat / 2],
+                (unsigned long long)lat[nlat - 1]);
+    }
+    if (nl_sock >= 0)
+        log_err("netlink: %llu overflow(s), %llu resync(s), last %.2fms\n",
+                (unsigned long long)metrics_get(M_NETLINK_OVERFLOWS),
+                (unsigned long long)metrics_get(M_RESYNCS), resync_last_ms);
+    log_err("reactor: %llu wakeup(s), %d source(s)\n",
+            (unsigned long long)metrics_get(M_WAKEUPS), source_count());
+}
+
+/* With a daemon overlay lit, print once its latest marks are in */
+static void dump_traces(void) {
+    if (!overlay_via_daemon || !trace_fetch(cur_trace, true)) print_traces();
+}
+
+/* No daemon: a standalone overlay process */
+static void spawn_overlay(void) {
+    metrics_inc(M_OVERLAY_SPAWNS);
+
+    char bstr[16], wstr[16], sstr[256];
+    snprintf(bstr, sizeof(bstr), "%d", brightness);
+    snprintf(wstr, sizeof(wstr), "%d", width);
+
+    /* A single overlay process lights every selected screen */
+    join_list(screens, screen_count, sstr, sizeof(sstr));
+
+    char *args[16];
+    int n = 0;
+    args[n++] = (char*)"ringlight-overlay";
+    args[n++] = (char*)"-c"; args[n++] = color;
+    args[n++] = (char*)"-b"; args[n++] = bstr;
+    args[n++] = (char*)"-w"; args[n++] = wstr;
+    if (fullscreen) args[n++] = (char*)"-f";
+    if (screen_count > 0) {
+        args[n++] = (char*)"-s";
+        args[n++] = sstr;
+    }
+    args[n] = NULL;
+    overlay_active = spawn_child(args, false) > 0;
+}
+
+static void start_overlay(void) {
+    if (overlay_active) return;
+    log_info("Starting overlay\n");
+    if (!cur_trace || cur_trace->command) trace_begin();
+    uint64_t t0 = cur_trace->command = now_us();
+    metrics_inc(M_OVERLAY_STARTS);
+
+    /* The daemon's answer is timed when it comes in */
+    if (daemon_show()) {
+        overlay_via_daemon = true;
+        overlay_active = true;
+    } else {
+        spawn_overlay();
+        metrics_observe(H_OVERLAY_START, now_us() - t0);
+    }
 }
 
 static void stop_overlay(void) {
     if (!overlay_active) return;
     log_info("Stopping overlay\n");
-    for (int i = 0; i < overlay_count; i++) {
-        if (overlay_pids[i] > 0) {
-            kill(overlay_pids[i], SIGTERM);
-            waitpid(overlay_pids[i], NULL, 0);
-        }
+    metrics_inc(M_OVERLAY_STOPS);
+    if (overlay_via_daemon) {
+        trace_fetch(cur_trace, false);
+        if (!daemon_send("hide", (daemon_cmd_t){ .verb = D_HIDE })) metrics_inc(M_DAEMON_ERRORS);
+        overlay_via_daemon = false;
+        overlay_active = false;
+        return;
     }
-    overlay_count = 0;
+    terminate_children();
     overlay_active = false;
 }
 
+static void restart_overlay(void) {
+    log_info("Restarting overlay with new settings\n");
+    stop_overlay();
+    start_overlay();
+}
+
+/* Carry new settings to a lit overlay; a standalone one only reads them at startup */
+static void restyle_overlay(void) {
+    if (!overlay_active) return;
+    if (overlay_via_daemon && daemon_style("set", 0, (daemon_cmd_t){ .verb = D_SET })) {
+        log_info("Restyling overlay\n");
+        return;
+    }
+    restart_overlay();
+}
+
+static void daemon_reply(const daemon_cmd_t *c, bool ok, const char *line) {
+    if (!ok) {
+        metrics_inc(M_DAEMON_ERRORS);
+        if (line && line[0]) log_err("Overlay daemon: %s\n", line);
+    }
+    switch (c->verb) {
+        case D_PING:
+            if (!ok) spawn_daemon_process();
+            break;
+        case D_SHOW:
+            if (ok) { metrics_observe(H_OVERLAY_START, now_us() - c->sent); break; }
+            /* Only the latest show still speaks for the light */
+            if (c->show != show_seq || !overlay_active || !overlay_via_daemon) break;
+            log_info("Overlay daemon unavailable, starting a standalone overlay\n");
+            overlay_via_daemon = false;
+            overlay_active = false;
+            spawn_overlay();
+            break;
+        case D_SET:
+            if (!ok && overlay_active && overlay_via_daemon) restart_overlay();
+            break;
+        case D_HIDE:
+            break;
+        case D_TRACE:
+            if (ok) trace_store(c->trace, line);
+            if (c->dump) print_traces();
+            break;
+    }
+}
+
+static void cleanup_control(void);
+static void export_metrics(void);
+
 static void cleanup(void) {
     stop_overlay();
+    daemon_disconnect();        /* the hide is already in the daemon's queue */
+    export_metrics();
+    reap_children_at_exit();
+    cleanup_control();
     if (nl_sock >= 0) close(nl_sock);
+    clear_watched_pids();
+    pidset_free(&watched);
+    if (cam_inotify >= 0) close(cam_inotify);
+    if (config_inotify >= 0) close(config_inotify);
+    if (uevent_sock >= 0) close(uevent_sock);
+    if (fan_fd >= 0) close(fan_fd);
+    if (epfd >= 0) close(epfd);
+    free(sources);
     for (int i = 0; i < watch_proc_count; i++) free(watch_procs[i]);
+    matcher_free(matcher);
     for (int i = 0; i < screen_count; i++) free(screens[i]);
 }
 
-static void verify_watched_pids(void) {
-    int i = 0;
-    while (i < watched_pid_count) {
-        if (kill(watched_pids[i], 0) != 0) {
-            log_info("Process exited: pid %d\n", watched_pids[i]);
-            watched_pids[i] = watched_pids[--watched_pid_count];
-        } else {
-            i++;
+/*
+ * Resync
+ *
+ * Events lost to a receive buffer overflow (ENOBUFS), or processes that
+ * started before us, are recovered by rebuilding the watched set from one
+ * getdents64 pass over /proc.
+ */
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* Our own children still carry our cmdline until they exec */
+static bool is_own_child(pid_t pid) {
+    char path[64], buf[512];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    char *p = strrchr(buf, ')');
+    int ppid;
+    return p && sscanf(p + 1, " %*c %d", &ppid) == 1 && ppid == getpid();
+}
+
+/* Track every matching process in /proc, after forgetting the current set if fresh; -1 on failure */
+static long scan_processes(bool fresh) {
+    int fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) { log_err("Cannot scan /proc: %s\n", strerror(errno)); return -1; }
+
+    long scanned = 0;
+    pid_t self = getpid();
+    char buf[32768];
+    long n;
+
+    if (fresh) clear_watched_pids();
+    while ((n = syscall(SYS_getdents64, fd, buf, sizeof(buf))) > 0) {
+        for (long off = 0; off < n; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+            off += d->d_reclen;
+            if (d->d_type != DT_DIR || d->d_name[0] < '1' || d->d_name[0] > '9') continue;
+            pid_t pid = atoi(d->d_name);
+            scanned++;
+            if (pid == self || !matches_watch_list(pid)) continue;
+            if (is_own_child(pid)) continue;
+            track_pid(pid);
         }
     }
+    close(fd);
+    update_netlink_filter();
+    return scanned;
+}
+
+/* Something besides the watch list holds the light: a trigger, or in hybrid mode a streaming camera */
+static bool other_holder(void) {
+    return trigger_held || (mode == MODE_HYBRID && probe_cameras());
+}
+
+static void resync_processes(const char *why) {
+    uint64_t t0 = now_us();
+    uint32_t before = watched.count;
+    long scanned = scan_processes(true);
+    if (scanned < 0) return;
+
+    uint64_t dt = now_us() - t0;
+    metrics_inc(M_RESYNCS);
+    metrics_add(M_RESYNC_SCANNED, scanned);
+    metrics_observe(H_RESYNC, dt);
+    resync_last_ms = dt / 1000.0;
+    log_info("Resync (%s): %ld processes in %.2fms, tracking %u (was %u)\n",
+             why, scanned, resync_last_ms, watched.count, before);
+
+    if (watched.count > 0 && !overlay_active) { trace_begin(); start_overlay(); }
+    else if (watched.count == 0 && overlay_active && !other_holder()) stop_overlay();
+}
+
+static void watched_pid_exited(pid_t pid) {
+    remove_watched_pid(pid);
+    if (watched.count == 0 && overlay_active && !other_holder()) {
+        log_info("All watched processes exited\n");
+        stop_overlay();
+    }
+}
+
+static void watched_pid_matched(pid_t pid) {
+    log_info("Matched process: pid %d\n", pid);
+    /* Gone before we could hold it: nothing to light for */
+    if (!add_watched_pid(pid)) { log_info("pid %d already exited\n", pid); return; }
+    if (!overlay_active) { trace_begin(); start_overlay(); }
 }
 
-static void process_netlink_event(char *buf) {
-    struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+static void process_netlink_event(struct nlmsghdr *nlh) {
+    if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(struct proc_event))) return;
     struct cn_msg *cn = NLMSG_DATA(nlh);
     struct proc_event *ev = (struct proc_event *)cn->data;
+    metrics_inc(M_PROC_EVENTS);
 
     if (ev->what == PROC_EVENT_EXEC) {
         pid_t pid = ev->event_data.exec.process_pid;
-        if (matches_watch_list(pid)) {
-            log_info("Matched process: pid %d\n", pid);
-            add_watched_pid(pid);
-            if (!overlay_active) start_overlay();
-        }
+        metrics_inc(M_EXEC_EVENTS);
+        if (matches_watch_list(pid)) watched_pid_matched(pid);
     } else if (ev->what == PROC_EVENT_EXIT) {
-        pid_t pid = ev->event_data.exit.process_pid;
-        if (watched_pid_count > 0) {
-            remove_watched_pid(pid);
-            if (watched_pid_count == 0 && overlay_active) {
-                log_info("All watched processes exited\n");
-                stop_overlay();
+        metrics_inc(M_EXIT_EVENTS);
+        if (watched.count > 0) watched_pid_exited(ev->event_data.exit.process_pid);
+    }
+}
+
+/* Receive everything queued on nl_sock in batches and handle every message */
+static void drain_netlink(void) {
+    uint64_t t0 = now_us();
+    bool overflow = false;
+    static char bufs[NL_BATCH][NL_BUF_SIZE];
+    struct mmsghdr msgs[NL_BATCH];
+    struct iovec iovs[NL_BATCH];
+
+    for (;;) {
+        for (int i = 0; i < NL_BATCH; i++) {
+            iovs[i] = (struct iovec){ .iov_base = bufs[i], .iov_len = NL_BUF_SIZE };
+            msgs[i] = (struct mmsghdr){ .msg_hdr = { .msg_iov = &iovs[i], .msg_iovlen = 1 } };
+        }
+        int n = recvmmsg(nl_sock, msgs, NL_BATCH, MSG_DONTWAIT, NULL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == ENOBUFS) { overflow = true; metrics_inc(M_NETLINK_OVERFLOWS); continue; }
+            break;      /* EAGAIN: drained */
+        }
+        event_us = now_us();
+        metrics_inc(M_NETLINK_BATCHES);
+
+        for (int i = 0; i < n; i++) {
+            int len = msgs[i].msg_len;
+            for (struct nlmsghdr *nlh = (struct nlmsghdr *)bufs[i]; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+                if (nlh->nlmsg_type == NLMSG_NOOP || nlh->nlmsg_type == NLMSG_ERROR) continue;
+                process_netlink_event(nlh);
             }
         }
+        if (n < NL_BATCH) break;
     }
+
+    /* Some events are gone for good; ask /proc instead */
+    if (overflow) {
+        log_info("Netlink receive buffer overflowed (%llu so far)\n",
+                 (unsigned long long)metrics_get(M_NETLINK_OVERFLOWS));
+        resync_processes("overflow");
+    }
+    metrics_observe(H_NETLINK_DRAIN, now_us() - t0);
 }
 
-static void run_process_mode(void) {
-    log_info("Process mode: watching %d process(es)\n", watch_proc_count);
+static void netlink_ready(int fd, void *ctx) {
+    (void)fd; (void)ctx;
+    drain_netlink();
+}
 
-    char buf[8192];
-    while (running) {
-        struct pollfd pfd = { .fd = nl_sock, .events = POLLIN };
-        int ret = poll(&pfd, 1, overlay_active ? 500 : -1);
+/*
+ * Exec watch (fanotify)
+ *
+ * The alternative to the proc connector: the resolved watch files are
+ * marked FAN_OPEN_EXEC, so the kernel wakes us only when one of them is
+ * executed and names the pid, with nothing read from /proc. Scripts are
+ * also marked FAN_OPEN for interpreters started as "python3 script.py";
+ * those opens, unlike execs, are confirmed against the watch list. This
+ * is a notification group - permission events would make every exec of
+ * howdy wait on us. Marks hold inodes, so a binary replaced by an upgrade
+ * is only seen again after a restart. Exits come from pidfds.
+ */
+/* Returns how many targets are marked */
+static int mark_exec_targets(void) {
+    int marked = 0;
+    for (int i = 0; i < exec_target_count; i++) {
+        exec_target_t *t = &exec_targets[i];
+        uint64_t mask = FAN_OPEN_EXEC | (t->script ? FAN_OPEN : 0);
+        if (fanotify_mark(fan_fd, FAN_MARK_ADD, mask, AT_FDCWD, t->path) < 0) {
+            log_err("Cannot mark %s: %s\n", t->path, strerror(errno));
+            continue;
+        }
+        log_info("Marked %s%s\n", t->path, t->script ? " (script)" : "");
+        marked++;
+    }
+    return marked;
+}
+
+static int setup_fanotify(void) {
+    if (exec_target_count == 0) { log_err("No watch entry resolves to a file\n"); return -1; }
+    int probe = open_pidfd(getpid());
+    if (probe < 0) { log_err("exec-fanotify needs pidfd_open (Linux 5.3)\n"); return -1; }
+    close(probe);
+
+    fan_fd = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK, O_RDONLY | O_CLOEXEC | O_LARGEFILE);
+    if (fan_fd < 0) {
+        log_err("fanotify_init failed (need CAP_SYS_ADMIN): %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (mark_exec_targets() == 0) { close(fan_fd); fan_fd = -1; return -1; }
+    return 0;
+}
+
+/* After a reload: mark the new targets first, then drop the ones no longer listed */
+static void remark_exec_targets(const exec_target_t *old, int old_count) {
+    mark_exec_targets();
+    for (int i = 0; i < old_count; i++) {
+        bool kept = false;
+        for (int j = 0; j < exec_target_count && !kept; j++) kept = strcmp(old[i].path, exec_targets[j].path) == 0;
+        if (kept) continue;
+        uint64_t mask = FAN_OPEN_EXEC | (old[i].script ? FAN_OPEN : 0);
+        if (fanotify_mark(fan_fd, FAN_MARK_REMOVE, mask, AT_FDCWD, old[i].path) == 0)
+            log_info("Unmarked %s\n", old[i].path);
+    }
+}
 
-        if (ret > 0 && (pfd.revents & POLLIN)) {
-            ssize_t len = recv(nl_sock, buf, sizeof(buf), MSG_DONTWAIT);
-            if (len > 0) process_netlink_event(buf);
+static void fanotify_ready(int fd, void *ctx) {
+    (void)ctx;
+    char buf[4096] __attribute__((aligned(__alignof__(struct fanotify_event_metadata))));
+    pid_t self = getpid();
+    ssize_t len;
+
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        event_us = now_us();
+        struct fanotify_event_metadata *m = (struct fanotify_event_metadata *)buf;
+        for (; FAN_EVENT_OK(m, len); m = FAN_EVENT_NEXT(m, len)) {
+            if (m->fd >= 0) close(m->fd);
+            if (m->vers != FANOTIFY_METADATA_VERSION) continue;
+            metrics_inc(M_FANOTIFY_EVENTS);
+            if (m->mask & FAN_OPEN_EXEC) metrics_inc(M_EXEC_EVENTS);
+            if (m->mask & FAN_Q_OVERFLOW) { resync_processes("fanotify overflow"); continue; }
+            if (m->pid == self || m->pid <= 0 || pidset_find(&watched, m->pid)) continue;
+            if (!(m->mask & FAN_OPEN_EXEC) && !matches_watch_list(m->pid)) continue;
+            watched_pid_matched(m->pid);
         }
+    }
+}
+
+static void update_camera(void) {
+    event_us = now_us();
+    bool active = probe_cameras();
+    if (active && !overlay_active) { log_info("Camera active\n"); start_overlay(); }
+    else if (!active && overlay_active && !trigger_held) { log_info("Camera inactive\n"); stop_overlay(); }
+}
+
+/* Someone may already be streaming; count them as one holder */
+static void initial_camera_check(void) {
+    bool any = false;
+    for (int i = 0; i < camera_count; i++) {
+        camera_t *cam = &cameras[i];
+        cam->streaming = v4l2_streaming(cam);
+        if (cam->streaming && cam->wd >= 0 && cam->opens == 0) cam->opens = 1;
+        any |= cam->streaming;
+    }
+    if (!any) return;
+    log_info("Camera active\n");
+    start_overlay();
+}
+
+/*
+ * Camera sources
+ *
+ * A foreign open or close probes at once and again CAMERA_SETTLE_MS after
+ * the last of a burst, by which time the opener has usually started (or
+ * stopped) streaming. The probe timer runs only while camera_timeout()
+ * asks for it.
+ */
+#define CAMERA_SETTLE_MS 150
+
+static reactor_timer_t probe_timer, settle_timer;
+
+static void camera_changed(void) {
+    /* In hybrid mode a watched process owns the overlay */
+    if (nl_sock < 0 || watched.count == 0) update_camera();
+
+    int ms = camera_timeout();
+    if (ms < 0 && probe_timer.armed) timer_arm(&probe_timer, 0, false);
+    else if (ms >= 0 && !probe_timer.armed) timer_arm(&probe_timer, ms, true);
+}
+
+static void camera_events_ready(int fd, void *ctx) {
+    (void)fd; (void)ctx;
+    if (!drain_camera_events()) return;
+    camera_changed();
+    timer_arm(&settle_timer, CAMERA_SETTLE_MS, false);
+}
+
+static void hotplug_ready(int fd, void *ctx) {
+    (void)fd; (void)ctx;
+    if (drain_hotplug()) camera_changed();
+}
+
+static void settle_expired(void) {
+    settle_timer.armed = false;
+    camera_changed();
+}
+
+static void add_camera_sources(void) {
+    reactor_add(cam_inotify, camera_events_ready, NULL);
+    reactor_add(uevent_sock, hotplug_ready, NULL);
+    timer_init(&probe_timer, camera_changed);
+    timer_init(&settle_timer, settle_expired);
+    initial_camera_check();
+    camera_changed();
+}
+
+/*
+ * Control socket
+ *
+ * $XDG_RUNTIME_DIR/ringlight-monitor.sock takes the same line protocol as
+ * the overlay daemon, from our own user or root (PAM runs as root):
+ *
+ * on [hold=SECONDS] [t0=USEC]   light until off, at most hold seconds
+ * off | status | ping
+ *
+ * The hold timer turns a lost "off" into a late one instead of a light
+ * that never goes out.
+ */
+#define MAX_CLIENTS 8
+#define TRIGGER_HOLD_S 30
+#define TRIGGER_HOLD_MAX_S 600
+
+typedef struct {
+    int fd;
+    char buf[CTL_LINE_MAX];
+    size_t len;
+} client_t;
+
+static client_t clients[MAX_CLIENTS];
+static int listen_fd = -1, lock_fd = -1;
+static char monitor_sock[PATH_MAX];
+static reactor_timer_t hold_timer;
+
+static bool cameras_streaming(void) {
+    for (int i = 0; i < camera_count; i++)
+        if (cameras[i].streaming) return true;
+    return false;
+}
+
+static void trigger_on(int hold_s, uint64_t t0) {
+    trigger_held = true;
+    timer_arm(&hold_timer, hold_s * 1000, false);
+    if (overlay_active) return;
+    log_info("Triggered on (hold %ds)\n", hold_s);
+    event_us = t0;
+    trace_begin();
+    start_overlay();
+}
+
+static void trigger_off(const char *why) {
+    if (!trigger_held) return;
+    trigger_held = false;
+    if (hold_timer.armed) timer_arm(&hold_timer, 0, false);
+    log_info("Triggered off (%s)\n", why);
+    if (overlay_active && watched.count == 0 && !cameras_streaming()) stop_overlay();
+}
+
+static void hold_expired(void) {
+    hold_timer.armed = false;
+    trigger_off("hold expired");
+}
+
+static void handle_command(char *line, char *reply, size_t len) {
+    char *save;
+    char *verb = strtok_r(line, " \t\r", &save);
+    if (!verb) { snprintf(reply, len, "error empty command"); return; }
+    metrics_inc(M_CONTROL_COMMANDS);
 
-        if (overlay_active && watched_pid_count > 0) {
-            verify_watched_pids();
-            if (watched_pid_count == 0) stop_overlay();
+    if (strcmp(verb, "on") == 0) {
+        int hold_s = TRIGGER_HOLD_S;
+        uint64_t t0 = now_us();
+        char *tok;
+        while ((tok = strtok_r(NULL, " \t\r", &save))) {
+            char *eq = strchr(tok, '=');
+            if (!eq) { snprintf(reply, len, "error expected key=value, got '%s'", tok); return; }
+            *eq = '\0';
+            if (strcmp(tok, "hold") == 0) hold_s = atoi(eq + 1);
+            else if (strcmp(tok, "t0") == 0) t0 = strtoull(eq + 1, NULL, 10);
+            else { snprintf(reply, len, "error unknown option '%s'", tok); return; }
         }
+        if (hold_s < 1) hold_s = 1;
+        if (hold_s > TRIGGER_HOLD_MAX_S) hold_s = TRIGGER_HOLD_MAX_S;
+        trigger_on(hold_s, t0);
+        snprintf(reply, len, "ok");
+    } else if (strcmp(verb, "off") == 0) {
+        trigger_off("requested");
+        snprintf(reply, len, "ok");
+    } else if (strcmp(verb, "status") == 0) {
+        snprintf(reply, len, "ok %s trigger=%d pids=%u", overlay_active ? "on" : "off",
+                 trigger_held, watched.count);
+    } else if (strcmp(verb, "stats") == 0) {
+        size_t n = snprintf(reply, len, "ok ");
+        if (n >= len || !metrics_format(reply + n, len - n)) snprintf(reply, len, "error stats too long");
+    } else if (strcmp(verb, "ping") == 0) {
+        snprintf(reply, len, "ok");
+    } else {
+        snprintf(reply, len, "error unknown command '%s'", verb);
     }
 }
 
-static void run_camera_mode(void) {
-    log_info("Camera mode: polling %s every %dms\n", video_dev, poll_interval_ms);
-    while (running) {
-        bool active = v4l2_streaming();
-        if (active && !overlay_active) { log_info("Camera active\n"); start_overlay(); }
-        else if (!active && overlay_active) { log_info("Camera inactive\n"); stop_overlay(); }
-        usleep(poll_interval_ms * 1000);
+static void client_close(client_t *c) {
+    reactor_remove(c->fd);
+    close(c->fd);
+    c->fd = -1;
+    c->len = 0;
+}
+
+static void client_ready(int fd, void *ctx) {
+    client_t *c = ctx;
+    ssize_t n = recv(fd, c->buf + c->len, sizeof(c->buf) - 1 - c->len, 0);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    if (n <= 0) { client_close(c); return; }
+    c->len += n;
+
+    char *start = c->buf, *nl;
+    while ((nl = memchr(start, '\n', c->buf + c->len - start))) {
+        *nl = '\0';
+        event_us = now_us();
+        char reply[CTL_REPLY_MAX];
+        handle_command(start, reply, sizeof(reply) - 1);
+        strcat(reply, "\n");
+        send(fd, reply, strlen(reply), MSG_NOSIGNAL | MSG_DONTWAIT);
+        start = nl + 1;
+    }
+    c->len -= start - c->buf;
+    memmove(c->buf, start, c->len);
+
+    if (c->len == sizeof(c->buf) - 1) {
+        log_err("Control command too long, dropping client\n");
+        client_close(c);
     }
 }
 
-static void run_hybrid_mode(void) {
-    log_info("Hybrid mode: process + camera poll %dms\n", poll_interval_ms);
+static void listen_ready(int fd, void *ctx) {
+    (void)ctx;
+    int cfd;
+    while ((cfd = ctl_accept(fd)) >= 0) {
+        client_t *slot = NULL;
+        for (int i = 0; i < MAX_CLIENTS && !slot; i++)
+            if (clients[i].fd < 0) slot = &clients[i];
+        if (!slot || !reactor_add(cfd, client_ready, slot)) { close(cfd); continue; }
+        slot->fd = cfd;
+        slot->len = 0;
+    }
+}
 
-    char buf[4096];
-    while (running) {
-        struct pollfd pfd = { .fd = nl_sock, .events = POLLIN };
-        int ret = poll(&pfd, 1, poll_interval_ms);
+static void setup_control(void) {
+    for (int i = 0; i < MAX_CLIENTS; i++) clients[i].fd = -1;
+    timer_init(&hold_timer, hold_expired);
+
+    if (!ctl_socket_path(CTL_MONITOR_SOCKET, monitor_sock, sizeof(monitor_sock))) {
+        log_err("Control socket path too long\n");
+        return;
+    }
+    listen_fd = ctl_listen(monitor_sock, &lock_fd);
+    if (listen_fd < 0) {
+        log_err("No control socket at %s: %s\n", monitor_sock,
+                errno == EADDRINUSE ? "another monitor owns it" : strerror(errno));
+        return;
+    }
+    reactor_add(listen_fd, listen_ready, NULL);
+    log_info("Control socket %s\n", monitor_sock);
+}
+
+static void cleanup_control(void) {
+    for (int i = 0; i < MAX_CLIENTS; i++)
+        if (clients[i].fd >= 0) close(clients[i].fd);
+    if (listen_fd >= 0) { close(listen_fd); unlink(monitor_sock); }
+    if (lock_fd >= 0) close(lock_fd);
+}
 
-        if (ret > 0 && (pfd.revents & POLLIN)) {
-            ssize_t len = recv(nl_sock, buf, sizeof(buf), MSG_DONTWAIT);
-            if (len > 0) process_netlink_event(buf);
+/*
+ * Metrics export
+ *
+ * With metrics_file set, the counters are written there every
+ * METRICS_EXPORT_MS in the Prometheus text format, for node-exporter's
+ * textfile collector, and once more on exit. The stats command serves
+ * the same numbers on demand.
+ */
+#define METRICS_EXPORT_MS 15000
+
+static reactor_timer_t metrics_timer;
+
+static void export_metrics(void) {
+    if (!metrics_file[0]) return;
+    if (metrics_write_textfile(metrics_file) < 0)
+        log_err("Cannot write metrics to %s: %s\n", metrics_file, strerror(errno));
+}
+
+static void update_metrics_export(void) {
+    bool want = metrics_file[0] != '\0';
+    if (want == metrics_timer.armed) return;
+    timer_arm(&metrics_timer, want ? METRICS_EXPORT_MS : 0, true);
+    if (want) { log_info("Exporting metrics to %s\n", metrics_file); export_metrics(); }
+}
+
+static void setup_metrics(void) {
+    metrics_init();
+    timer_init(&metrics_timer, export_metrics);
+    update_metrics_export();
+}
+
+/* --stats: ask a running monitor and print its numbers one per line */
+static int print_stats(void) {
+    char path[PATH_MAX], reply[CTL_REPLY_MAX];
+    if (!ctl_socket_path(CTL_MONITOR_SOCKET, path, sizeof(path)) ||
+        ctl_request(path, "stats", reply, sizeof(reply), 1000) < 0) {
+        fprintf(stderr, "ringlight-monitor: no monitor answered on %s\n", path);
+        return 1;
+    }
+    char *save, *tok = strtok_r(reply + 2, " ", &save);
+    for (; tok; tok = strtok_r(NULL, " ", &save)) {
+        char *eq = strchr(tok, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        printf("%-28s %s\n", tok, eq + 1);
+    }
+    return 0;
+}
+
+/*
+ * Config reload
+ *
+ * The directory holding config.ini is watched rather than the file, since
+ * editors and the GUI replace it by rename. Once a burst of changes has
+ * settled for CONFIG_RELOAD_MS the file is applied in place: the matcher
+ * and exec marks are swapped and /proc is scanned for processes only the
+ * new list covers, the camera set is brought in line, and a lit overlay
+ * is restyled. The netlink subscription and tracked pids are kept; a pid
+ * the new list no longer covers keeps the light until it exits. Only a
+ * change of mode waits for a restart. SIGHUP reloads as well.
+ */
+#define CONFIG_RELOAD_MS 100
+
+static char config_name[NAME_MAX + 1];
+static reactor_timer_t reload_timer;
+static enum monitor_mode requested_mode;    /* as configured, before any fallback */
+
+static void reload_config(void) {
+    static exec_target_t old_targets[MAX_ITEMS];
+    char old_watch[1024], new_watch[1024], old_style[CTL_LINE_MAX], new_style[CTL_LINE_MAX];
+    char old_dev[sizeof(video_dev)];
+    enum monitor_mode running_mode = mode;
+    int old_target_count = exec_target_count, old_poll = poll_interval_ms;
+    bool old_legacy = use_legacy_matcher;
+
+    join_list(watch_procs, watch_proc_count, old_watch, sizeof(old_watch));
+    overlay_options(old_style, sizeof(old_style));
+    memcpy(old_targets, exec_targets, old_target_count * sizeof(exec_targets[0]));
+    memcpy(old_dev, video_dev, sizeof(video_dev));
+
+    event_us = now_us();
+    load_config();
+    metrics_inc(M_CONFIG_RELOADS);
+    log_info("Config reloaded\n");
+
+    if (mode != requested_mode) {
+        log_err("mode=%s takes effect on restart\n", mode_names[mode]);
+        requested_mode = mode;
+    }
+    mode = running_mode;
+
+    join_list(watch_procs, watch_proc_count, new_watch, sizeof(new_watch));
+    if (strcmp(old_watch, new_watch) != 0 || old_legacy != use_legacy_matcher) {
+        log_info("Watching %s (%s matcher)\n", new_watch, use_legacy_matcher || !matcher ? "legacy" : "compiled");
+        if (fan_fd >= 0) remark_exec_targets(old_targets, old_target_count);
+        if ((nl_sock >= 0 || fan_fd >= 0) && scan_processes(false) >= 0 && watched.count > 0 && !overlay_active) {
+            trace_begin();
+            start_overlay();
+        }
+    }
+
+    if (mode == MODE_CAMERA || mode == MODE_HYBRID) {
+        if (strcmp(old_dev, video_dev) != 0) {
+            sync_cameras();
+            log_info("Cameras: %d (%s)\n", camera_count, cameras_auto ? "auto" : video_dev);
+            initial_camera_check();
         }
+        if (old_poll != poll_interval_ms && probe_timer.armed) timer_arm(&probe_timer, poll_interval_ms, true);
+        camera_changed();
+    }
+
+    overlay_options(new_style, sizeof(new_style));
+    if (strcmp(old_style, new_style) != 0) restyle_overlay();
+    update_metrics_export();
+}
+
+static void reload_expired(void) {
+    reload_timer.armed = false;
+    reload_config();
+}
 
-        if (watched_pid_count == 0) {
-            bool cam = v4l2_streaming();
-            if (cam && !overlay_active) { log_info("Camera active\n"); start_overlay(); }
-            else if (!cam && overlay_active) { log_info("Camera inactive\n"); stop_overlay(); }
+static void config_dir_ready(int fd, void *ctx) {
+    (void)ctx;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (ev->mask & IN_IGNORED) log_err("Config directory went away, reload with SIGHUP\n");
+            else if (ev->len && strcmp(ev->name, config_name) == 0) changed = true;
         }
     }
+    if (changed) timer_arm(&reload_timer, CONFIG_RELOAD_MS, false);
+}
+
+static void setup_config_watch(void) {
+    timer_init(&reload_timer, reload_expired);
+
+    char dir[PATH_MAX];
+    if (!config_path(dir, sizeof(dir))) return;
+    char *slash = strrchr(dir, '/');
+    snprintf(config_name, sizeof(config_name), "%s", slash + 1);
+    *slash = '\0';
+
+    /* The first save may come after us; have the directory ready for it */
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        mkdir(dir, 0700);
+        *p = '/';
+    }
+    mkdir(dir, 0755);
+
+    config_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (config_inotify < 0 ||
+        inotify_add_watch(config_inotify, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0 ||
+        !reactor_add(config_inotify, config_dir_ready, NULL)) {
+        log_err("Not watching %s for changes: %s\n", dir, strerror(errno));
+        if (config_inotify >= 0) close(config_inotify);
+        config_inotify = -1;
+    }
+}
+
+/* SIGINT/SIGTERM stop the loop, SIGUSR1 dumps traces, SIGHUP reloads, SIGCHLD reaps without pidfds */
+static void signals_ready(int fd, void *ctx) {
+    (void)ctx;
+    struct signalfd_siginfo si;
+    while (read(fd, &si, sizeof(si)) == sizeof(si)) {
+        if (si.ssi_signo == SIGUSR1) dump_traces();
+        else if (si.ssi_signo == SIGHUP) reload_config();
+        else if (si.ssi_signo == SIGCHLD) reap_children();
+        else running = false;
+    }
+}
+
+static int setup_signals(void) {
+    sigemptyset(&sig_mask);
+    sigaddset(&sig_mask, SIGINT);
+    sigaddset(&sig_mask, SIGTERM);
+    sigaddset(&sig_mask, SIGUSR1);
+    sigaddset(&sig_mask, SIGHUP);
+    sigprocmask(SIG_BLOCK, &sig_mask, &orig_sigmask);
+    signal_fd = signalfd(-1, &sig_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0 || !reactor_add(signal_fd, signals_ready, NULL)) {
+        log_err("signalfd: %s\n", strerror(errno));
+        return -1;
+    }
+    return signal_fd;
 }
 
 static void usage(const char *prog) {
     printf("Usage: %s [options]\n\n"
            "Modes:\n"
-           "  -m, --mode MODE      process|camera|hybrid (default: process)\n"
+           "  -m, --mode MODE      process|camera|hybrid|exec-fanotify|trigger (default: process)\n"
            "                       process: netlink-based, requires CAP_NET_ADMIN\n"
            "                       camera: poll for any camera activity\n"
-           "                       hybrid: both methods combined\n\n"
+           "                       hybrid: both methods combined\n"
+           "                       exec-fanotify: execs of the watched files only,\n"
+           "                       requires CAP_SYS_ADMIN\n"
+           "                       trigger: only on/off from ringlight-trigger or PAM\n\n"
            "Options:\n"
-           "  -d, --device PATH    Video device (default: /dev/video0)\n"
+           "  -d, --device LIST    Video devices, comma-separated, or auto (default: auto)\n"
            "  -p, --proc NAME      Process to watch, repeatable (default: howdy)\n"
            "  -i, --interval MS    Poll interval for camera mode (default: 2000)\n"
+           "  -M, --matcher KIND   compiled|legacy exec matching (default: compiled)\n"
+           "  -e, --metrics-file PATH  Keep Prometheus metrics there (node-exporter textfile)\n"
+           "  -S, --stats          Print a running monitor's counters and latencies, then exit\n"
            "  -v, --verbose        Verbose output\n"
-           "  -h, --help           Show help\n", prog);
+           "  -h, --help           Show help\n\n"
+           "Changes to ~/.config/ringlight/config.ini apply while running (or on SIGHUP),\n"
+           "except mode. Send SIGUSR1 to dump activation latency traces to stderr.\n", prog);
 }
 
 int main(int argc, char *argv[]) {
@@ -384,36 +2049,53 @@ int main(int argc, char *argv[]) {
         {"device", required_argument, 0, 'd'},
         {"proc", required_argument, 0, 'p'},
         {"interval", required_argument, 0, 'i'},
+        {"matcher", required_argument, 0, 'M'},
+        {"metrics-file", required_argument, 0, 'e'},
+        {"stats", no_argument, 0, 'S'},
         {"verbose", no_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
 
     int c;
-    while ((c = getopt_long(argc, argv, "m:d:p:i:vh", opts, NULL)) != -1) {
+    while ((c = getopt_long(argc, argv, "m:d:p:i:M:e:Svh", opts, NULL)) != -1) {
         switch (c) {
-            case 'm':
-                if (strcmp(optarg, "process") == 0) mode = MODE_PROCESS;
-                else if (strcmp(optarg, "camera") == 0) mode = MODE_CAMERA;
-                else if (strcmp(optarg, "hybrid") == 0) mode = MODE_HYBRID;
-                break;
+            case 'm': parse_mode(optarg, &mode); break;
             case 'd': strncpy(video_dev, optarg, sizeof(video_dev)-1); break;
             case 'p': if (watch_proc_count < MAX_ITEMS) watch_procs[watch_proc_count++] = strdup(optarg); break;
-            case 'i': poll_interval_ms = atoi(optarg); if (poll_interval_ms < 100) poll_interval_ms = 100; break;
+            case 'i': poll_interval_ms = config_int("poll_interval", optarg); break;
+            case 'M': matcher_opt = optarg; break;
+            case 'e': snprintf(metrics_file, sizeof(metrics_file), "%s", optarg); break;
+            case 'S': return print_stats();
             case 'v': verbose = true; break;
             case 'h': usage(argv[0]); return 0;
         }
     }
 
+    save_base();
     load_config();
-    if (watch_proc_count == 0) watch_procs[watch_proc_count++] = strdup("howdy");
+    requested_mode = mode;
+    log_info("Matcher: %s\n", use_legacy_matcher || !matcher ? "legacy" : "compiled");
 
-    signal(SIGINT, sig_handler);
-    signal(SIGTERM, sig_handler);
-    signal(SIGCHLD, SIG_IGN);
+    if (reactor_init() < 0 || setup_signals() < 0) return 1;
+    timer_init(&kill_timer, kill_expired);
     atexit(cleanup);
+    spawn_overlay_daemon();
+
+    setup_control();
+    setup_config_watch();
+    setup_metrics();
 
-    if (mode != MODE_CAMERA) {
+    if (mode == MODE_EXEC_FANOTIFY) {
+        if (setup_fanotify() == 0) {
+            resync_processes("startup");
+        } else {
+            log_err("fanotify unavailable, using the netlink engine\n");
+            mode = MODE_PROCESS;
+        }
+    }
+
+    if (mode == MODE_PROCESS || mode == MODE_HYBRID) {
         if (setup_netlink() < 0) {
             if (mode == MODE_PROCESS) {
                 log_err("Process mode requires CAP_NET_ADMIN capability.\n");
@@ -422,14 +2104,28 @@ int main(int argc, char *argv[]) {
             }
             log_err("Netlink failed, falling back to camera mode\n");
             mode = MODE_CAMERA;
+        } else {
+            /* Subscribed first, so nothing can slip between the scan and the events */
+            resync_processes("startup");
         }
     }
 
+    /* A mode is the set of sources it adds */
+    if (nl_sock >= 0) reactor_add(nl_sock, netlink_ready, NULL);
+    if (fan_fd >= 0) reactor_add(fan_fd, fanotify_ready, NULL);
+    if (mode == MODE_CAMERA || mode == MODE_HYBRID) {
+        setup_camera_watch();
+        add_camera_sources();
+    }
+
     switch (mode) {
-        case MODE_PROCESS: run_process_mode(); break;
-        case MODE_CAMERA:  run_camera_mode(); break;
-        case MODE_HYBRID:  run_hybrid_mode(); break;
+        case MODE_PROCESS: log_info("Process mode: watching %d process(es)\n", watch_proc_count); break;
+        case MODE_CAMERA:  log_info("Camera mode: probing every %dms while a camera is open\n", poll_interval_ms); break;
+        case MODE_HYBRID:  log_info("Hybrid mode: process + camera watch\n"); break;
+        case MODE_EXEC_FANOTIFY: log_info("Exec mode: watching %d file(s) with fanotify\n", exec_target_count); break;
+        case MODE_TRIGGER: log_info("Trigger mode: lit only over %s\n", monitor_sock); break;
     }
+    reactor_run();
 
     return 0;
 }
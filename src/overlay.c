@@ -3,6 +3,15 @@
  * 
  * Uses wlr-layer-shell protocol for multi-monitor support.
  * Click anywhere on the overlay to close.
+ *
+ * The border is a single colour, so when the compositor offers
+ * wp_viewporter every panel shows one shared 1x1 buffer (or a small shm
+ * tile) scaled to the panel size; full-size shm buffers are the fallback.
+ *
+ * With --daemon the overlay stays connected to the compositor and shows or
+ * hides the light on request from a control socket in $XDG_RUNTIME_DIR, so
+ * triggering it costs a command instead of a fresh Wayland client, and a
+ * shown light can be restyled in place.
  * 
  * Copyright (C) 2024-2025 Bryan
  * SPDX-License-Identifier: GPL-3.0-or-later
@@ -21,22 +30,38 @@
 #include <errno.h>
 #include <getopt.h>
 #include <limits.h>
-#include <pwd.h>
 #include <time.h>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
 
 #include <wayland-client.h>
 #include "xdg-shell-client.h"
 #include "wlr-layer-shell-unstable-v1-client.h"
+#include "viewporter-client.h"
+#include "single-pixel-buffer-v1-client.h"
+#include "fractional-scale-v1-client.h"
+#include "presentation-time-client.h"
+#include "config.h"
+#include "control.h"
+#include "fill.h"
 
 /* Configuration */
 static int cfg_border_width = 80;
 static int cfg_brightness = 100;
 static uint32_t cfg_color = 0xFFFFFF;
 static bool cfg_fullscreen = false;
-static char cfg_target_name[64] = "";
 static bool cfg_list_only = false;
+static bool cfg_json = false;
 static bool cfg_verbose = false;
+static bool cfg_daemon = false;
+static bool cfg_timing = false;
+
+/* Screen selection by name or registry index; empty means the first output */
+#define MAX_SCREENS 8
+static char cfg_screens[MAX_SCREENS][64];
+static int cfg_num_screens = 0;
+static bool cfg_all_screens = false;
 
 /* Wayland State */
 static struct wl_display *wl_display;
@@ -46,45 +71,203 @@ static struct wl_shm *wl_shm;
 static struct wl_seat *wl_seat;
 static struct wl_pointer *wl_pointer;
 static struct zwlr_layer_shell_v1 *layer_shell;
+static struct wp_viewporter *viewporter;
+static struct wp_single_pixel_buffer_manager_v1 *single_pixel_mgr;
+static struct wp_fractional_scale_manager_v1 *fractional_mgr;
+static struct wp_presentation *presentation;
+static uint32_t presentation_clock = CLOCK_MONOTONIC;
+
+static bool running = true;
+static int exit_status = 0;
+
+/*
+ * Startup
+ *
+ * No blind roundtrips: a sync after the registry marks the end of the
+ * globals, and a second sync after the binds marks every output's info as
+ * delivered. Panels for a selected output are requested as soon as that
+ * output is done, so the first surface does not wait for the others.
+ */
+static bool globals_done = false;
+static bool outputs_settled = false;
 
-static volatile sig_atomic_t running = 1;
+/* --timing marks on CLOCK_MONOTONIC, in seconds */
+static double t_start, t_connected, t_globals, t_configure, t_commit;
 
-/* Output Tracking */
-#define MAX_OUTPUTS 8
+/*
+ * Show Trace
+ *
+ * Microsecond CLOCK_MONOTONIC marks for the latest show, from the t0 the
+ * client passed in (the monitor's exec event) to the frame actually being
+ * presented. Reported by the "trace" command.
+ */
+static struct {
+    uint64_t t0, configure, commit, presented;
+    bool feedback_pending;
+} trace;
 
+/*
+ * Output Tracking
+ *
+ * Outputs come and go with docks and hotplug, so they live in a growable
+ * table keyed by registry name, each entry allocated on its own so panels
+ * can keep pointing at it. An output that reaches done while the light is
+ * on and is selected gets its panels then; one that goes away takes only
+ * its own panels with it.
+ *
+ * Screens are identified by connector name (DP-2, eDP-1), which is what
+ * --list --json and the daemon's list command report and what the GUI and
+ * config.ini store. Indices into the registry order still resolve, but are
+ * not stable across compositor restarts or hotplug.
+ */
 typedef struct {
-    struct wl_output *wl_output;
+    uint32_t global;            /* registry name */
+    struct wl_output *wl_output;    /* NULL once released as not needed */
     char name[64];
+    char description[128];
+    char make[64], model[64];
     int32_t width, height;
+    int32_t refresh;            /* mHz */
     int32_t x, y;
     int32_t scale;
     bool done;
 } output_t;
 
-static output_t outputs[MAX_OUTPUTS];
-static int num_outputs = 0;
+/* Longest --list --json output, which the list reply also has to fit */
+#define INVENTORY_MAX CTL_REPLY_MAX
+
+static output_t **outputs = NULL;
+static int num_outputs = 0, outputs_cap = 0;
 
 /* Panel (Layer Surface) */
 typedef struct {
+    output_t *output;
     struct wl_surface *wl_surface;
     struct zwlr_layer_surface_v1 *layer_surface;
-    struct wl_buffer *buffer;
-    void *buffer_data;
-    size_t buffer_size;
-    uint32_t width, height;
+    struct wp_viewport *viewport;
+    struct wp_fractional_scale_v1 *fractional;
+    struct cached_buffer *cached;
+    struct wl_buffer *solid;        /* single-pixel buffer attached, if any */
+    struct wl_callback *frame;      /* restyle throttle, NULL when idle */
+    uint32_t anchor;
+    uint32_t req_width, req_height; /* size last asked of the compositor */
+    uint32_t width, height;         /* logical size */
+    uint32_t scale120;              /* preferred fractional scale, 0 until known */
     bool configured;
+    bool resizing;                  /* set_size sent, its configure not yet in */
+    bool restyle_pending;           /* a restyle arrived while frame or resize was out */
 } panel_t;
 
-#define MAX_PANELS 5
-static panel_t *panels[MAX_PANELS];
-static int num_panels = 0;
+/* Rendering */
+enum render_path {
+    RENDER_SINGLE_PIXEL,    /* wp_single_pixel_buffer 1x1, scaled by viewport */
+    RENDER_SHM_TILE,        /* small shm tile, scaled by viewport */
+    RENDER_SHM,             /* full-size shm buffer per panel */
+};
+
+static const char *render_path_names[] = { "single-pixel", "shm-tile", "shm" };
+static enum render_path render_path = RENDER_SHM;
+static int cfg_render = -1;             /* forced render path, -1 for automatic */
+
+/* The light is always opaque; XRGB lets the compositor skip alpha entirely */
+static uint32_t shm_format = WL_SHM_FORMAT_ARGB8888;
+
+/* One single-pixel buffer shared by every panel */
+static struct wl_buffer *solid_buffer;
+static uint32_t solid_pixel;
+
+/*
+ * Buffer Cache
+ *
+ * All shm buffers live in one shared pool and are handed out per distinct
+ * (size, pixel) key, so top/bottom and left/right panels share a wl_buffer
+ * and a re-configure to an unchanged size is a lookup. Unreferenced entries
+ * stay cached until their slot is needed for another key. New buffers go in
+ * the lowest gap between live ones, so space given up by evicted entries is
+ * reused and the pool only grows past its peak live size.
+ */
+#define TILE_SIZE 16
+#define MAX_CACHED_BUFFERS 16
+
+typedef struct cached_buffer {
+    struct wl_buffer *buffer;
+    uint32_t width, height, pixel;
+    size_t offset, size;        /* page-aligned slot in the pool */
+    int refs;
+    bool busy;                  /* attached until the compositor releases it */
+} cached_buffer_t;
+
+static struct {
+    int fd;
+    struct wl_shm_pool *pool;
+    size_t size;
+    cached_buffer_t entries[MAX_CACHED_BUFFERS];
+} shm_cache = { .fd = -1 };
+
+static panel_t **panels = NULL;
+static int num_panels = 0, panels_cap = 0;
+static bool shown = false;          /* the light is on, lit wherever a selected output is */
 static struct wl_surface *pointer_surface;
 
+/* Daemon Control */
+#define MAX_CLIENTS 8
+
+typedef struct {
+    int fd;
+    char buf[CTL_LINE_MAX];
+    size_t len;
+} client_t;
+
+static client_t clients[MAX_CLIENTS];
+static int listen_fd = -1, lock_fd = -1;
+static char socket_path[PATH_MAX];
+static bool hide_pending = false;
+
+/*
+ * Event Loop
+ *
+ * Wayland, signals (through signalfd), the control socket and its clients
+ * share one epoll set waited on with no timeout, so an overlay that is
+ * just showing a colour never wakes up on its own.
+ */
+enum { EV_WAYLAND, EV_SIGNAL, EV_LISTEN, EV_CLIENT };  /* EV_CLIENT + index */
+
+static int epoll_fd = -1, signal_fd = -1;
+
+/* Wakeup accounting, reported in verbose mode */
+static uint64_t wakeups, window_wakeups;
+static double loop_start, window_start;
+
 /* Helpers */
 #define LOG(...) do { if (cfg_verbose) fprintf(stderr, "[ringlight] " __VA_ARGS__); } while(0)
 #define ERR(...) fprintf(stderr, "[ringlight] " __VA_ARGS__)
 
-static void sig_handler(int sig) { (void)sig; running = 0; }
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void report_timing(void) {
+    if (!cfg_timing) return;
+    fprintf(stderr, "[ringlight] timing: connect %.0fus, globals %.0fus, "
+            "first configure %.0fus, first commit %.0fus\n",
+            (t_connected - t_start) * 1e6, (t_globals - t_start) * 1e6,
+            t_configure ? (t_configure - t_start) * 1e6 : 0,
+            t_commit ? (t_commit - t_start) * 1e6 : 0);
+}
+
+/* A standalone overlay exits when dismissed; the daemon just goes dark */
+static void request_close(void) {
+    if (cfg_daemon) hide_pending = true;
+    else running = false;
+}
 
 static int create_shm_file(size_t size) {
     int fd = -1;
@@ -114,62 +297,219 @@ static int create_shm_file(size_t size) {
     return fd;
 }
 
-static bool create_panel_buffer(panel_t *panel) {
-    if (panel->width == 0 || panel->height == 0) {
-        ERR("Invalid panel dimensions: %ux%u\n", panel->width, panel->height);
-        return false;
+/* Border colour as ARGB8888 with brightness applied */
+static uint32_t current_pixel(void) {
+    uint32_t r = ((cfg_color >> 16) & 0xFF) * cfg_brightness / 100;
+    uint32_t g = ((cfg_color >> 8) & 0xFF) * cfg_brightness / 100;
+    uint32_t b = (cfg_color & 0xFF) * cfg_brightness / 100;
+    return (0xFFu << 24) | (r << 16) | (g << 8) | b;
+}
+
+static void choose_render_path(void) {
+    if (viewporter && single_pixel_mgr) render_path = RENDER_SINGLE_PIXEL;
+    else if (viewporter) render_path = RENDER_SHM_TILE;
+    else render_path = RENDER_SHM;
+    /* A forced path is honoured only if the compositor can do it */
+    if (cfg_render > (int)render_path) render_path = cfg_render;
+    LOG("Render path: %s, shm format %s\n", render_path_names[render_path],
+        shm_format == WL_SHM_FORMAT_XRGB8888 ? "XRGB8888" : "ARGB8888");
+}
+
+/* Shm Callbacks */
+static void shm_format_event(void *data, struct wl_shm *shm, uint32_t format) {
+    (void)data; (void)shm;
+    if (format == WL_SHM_FORMAT_XRGB8888) shm_format = WL_SHM_FORMAT_XRGB8888;
+}
+
+static const struct wl_shm_listener shm_listener = {
+    .format = shm_format_event,
+};
+
+/* Mark the whole panel opaque so whatever is underneath can be occluded */
+static void set_panel_opaque(panel_t *panel) {
+    struct wl_region *region = wl_compositor_create_region(wl_compositor);
+    if (!region) return;
+    wl_region_add(region, 0, 0, panel->width, panel->height);
+    wl_surface_set_opaque_region(panel->wl_surface, region);
+    wl_region_destroy(region);
+}
+
+static bool solid_in_use(struct wl_buffer *buffer, const panel_t *skip) {
+    for (int i = 0; i < num_panels; i++)
+        if (panels[i] && panels[i] != skip && panels[i]->solid == buffer) return true;
+    return false;
+}
+
+/* An old colour's buffer goes once the last panel showing it has moved on */
+static void solid_retire(struct wl_buffer *buffer, const panel_t *skip) {
+    if (buffer && buffer != solid_buffer && !solid_in_use(buffer, skip)) wl_buffer_destroy(buffer);
+}
+
+/* The shared single-pixel buffer, recreated when the colour changes */
+static struct wl_buffer *get_solid_buffer(void) {
+    uint32_t pixel = current_pixel();
+    if (solid_buffer && solid_pixel == pixel) return solid_buffer;
+    /* Panels not restyled yet keep showing the old one */
+    if (solid_buffer && !solid_in_use(solid_buffer, NULL)) wl_buffer_destroy(solid_buffer);
+    
+    /* Expand 8-bit channels to the full 32-bit range */
+    solid_buffer = wp_single_pixel_buffer_manager_v1_create_u32_rgba_buffer(single_pixel_mgr,
+        ((pixel >> 16) & 0xFF) * 0x01010101u, ((pixel >> 8) & 0xFF) * 0x01010101u,
+        (pixel & 0xFF) * 0x01010101u, 0xFFFFFFFFu);
+    
+    if (!solid_buffer) ERR("Failed to create solid buffer\n");
+    solid_pixel = pixel;
+    return solid_buffer;
+}
+
+static void buffer_release(void *data, struct wl_buffer *buffer) {
+    (void)buffer;
+    ((cached_buffer_t *)data)->busy = false;
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+    .release = buffer_release,
+};
+
+static size_t page_align(size_t size) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    return (size + page - 1) & ~(page - 1);
+}
+
+/* Lowest offset where size bytes fit between the live buffers */
+static size_t buffer_cache_gap(size_t size) {
+    size_t offset = 0;
+    bool moved = true;
+    while (moved) {
+        moved = false;
+        for (int i = 0; i < MAX_CACHED_BUFFERS; i++) {
+            cached_buffer_t *e = &shm_cache.entries[i];
+            if (e->buffer && e->offset < offset + size && offset < e->offset + e->size) {
+                offset = e->offset + e->size;
+                moved = true;
+            }
+        }
     }
+    return offset;
+}
+
+/* Make the pool at least need bytes long */
+static bool buffer_cache_grow(size_t need) {
+    if (need <= shm_cache.size) return true;
     
-    int stride = panel->width * 4;
-    size_t size = stride * panel->height;
+    /* Pages are only allocated when written, so over-reserving is free */
+    size_t new_size = need > shm_cache.size * 2 ? need : shm_cache.size * 2;
+    if (new_size > INT32_MAX) new_size = need;
+    if (new_size > INT32_MAX) { ERR("shm pool too large\n"); return false; }
     
-    int fd = create_shm_file(size);
-    if (fd < 0) return false;
+    if (!shm_cache.pool) {
+        shm_cache.fd = create_shm_file(new_size);
+        if (shm_cache.fd < 0) return false;
+        shm_cache.pool = wl_shm_create_pool(wl_shm, shm_cache.fd, new_size);
+        if (!shm_cache.pool) {
+            ERR("Failed to create shm pool\n");
+            close(shm_cache.fd);
+            shm_cache.fd = -1;
+            return false;
+        }
+    } else {
+        if (ftruncate(shm_cache.fd, new_size) < 0) {
+            ERR("Failed to resize shm pool: %s\n", strerror(errno));
+            return false;
+        }
+        wl_shm_pool_resize(shm_cache.pool, new_size);
+    }
+    shm_cache.size = new_size;
+    return true;
+}
+
+/* Pick a slot: an idle entry big enough to recycle, else the lowest free pool space */
+static cached_buffer_t *buffer_cache_slot(size_t size) {
+    cached_buffer_t *free_entry = NULL;
+    for (int i = 0; i < MAX_CACHED_BUFFERS; i++) {
+        cached_buffer_t *e = &shm_cache.entries[i];
+        if (!e->buffer) {
+            if (!free_entry) free_entry = e;
+        } else if (e->refs == 0 && !e->busy && e->size >= size) {
+            wl_buffer_destroy(e->buffer);
+            e->buffer = NULL;
+            return e;
+        }
+    }
     
-    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (data == MAP_FAILED) {
-        ERR("mmap failed: %s\n", strerror(errno));
-        close(fd);
-        return false;
+    if (!free_entry) {
+        /* Give up the slot of any idle entry and take fresh space */
+        for (int i = 0; i < MAX_CACHED_BUFFERS && !free_entry; i++) {
+            cached_buffer_t *e = &shm_cache.entries[i];
+            if (e->refs == 0 && !e->busy) {
+                wl_buffer_destroy(e->buffer);
+                e->buffer = NULL;
+                free_entry = e;
+            }
+        }
+        if (!free_entry) { ERR("Buffer cache full\n"); return NULL; }
     }
     
-    /* Fill with color (ARGB8888) */
-    uint32_t r = ((cfg_color >> 16) & 0xFF) * cfg_brightness / 100;
-    uint32_t g = ((cfg_color >> 8) & 0xFF) * cfg_brightness / 100;
-    uint32_t b = (cfg_color & 0xFF) * cfg_brightness / 100;
-    uint32_t pixel = (0xFFu << 24) | (r << 16) | (g << 8) | b;
+    size_t offset = buffer_cache_gap(size);
+    if (!buffer_cache_grow(offset + size)) return NULL;
+    free_entry->offset = offset;
+    free_entry->size = size;
+    return free_entry;
+}
+
+/* Get a referenced buffer of the given size filled with pixel */
+static cached_buffer_t *buffer_cache_get(uint32_t width, uint32_t height, uint32_t pixel) {
+    if (width == 0 || height == 0) {
+        ERR("Invalid panel dimensions: %ux%u\n", width, height);
+        return NULL;
+    }
     
-    uint32_t *pixels = data;
-    size_t count = panel->width * panel->height;
-    for (size_t i = 0; i < count; i++) pixels[i] = pixel;
+    for (int i = 0; i < MAX_CACHED_BUFFERS; i++) {
+        cached_buffer_t *e = &shm_cache.entries[i];
+        if (e->buffer && e->width == width && e->height == height && e->pixel == pixel) {
+            e->refs++;
+            return e;
+        }
+    }
     
-    struct wl_shm_pool *pool = wl_shm_create_pool(wl_shm, fd, size);
-    close(fd);
+    int stride = width * 4;
+    size_t size = page_align((size_t)stride * height);
+    cached_buffer_t *e = buffer_cache_slot(size);
+    if (!e) return NULL;
     
-    if (!pool) {
-        ERR("Failed to create shm pool\n");
-        munmap(data, size);
-        return false;
+    /* Fill through a temporary mapping; the pages stay in the pool */
+    uint32_t *pixels = mmap(NULL, e->size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_cache.fd, e->offset);
+    if (pixels == MAP_FAILED) {
+        ERR("mmap failed: %s\n", strerror(errno));
+        return NULL;
     }
+    fill_pixels(pixels, pixel, (size_t)width * height);
+    munmap(pixels, e->size);
     
-    panel->buffer = wl_shm_pool_create_buffer(pool, 0, panel->width, panel->height, stride, WL_SHM_FORMAT_ARGB8888);
-    wl_shm_pool_destroy(pool);
-    
-    if (!panel->buffer) {
+    e->buffer = wl_shm_pool_create_buffer(shm_cache.pool, e->offset, width, height, stride, shm_format);
+    if (!e->buffer) {
         ERR("Failed to create wl_buffer\n");
-        munmap(data, size);
-        return false;
+        return NULL;
     }
-    
-    panel->buffer_data = data;
-    panel->buffer_size = size;
-    LOG("Created buffer %ux%u\n", panel->width, panel->height);
-    return true;
+    wl_buffer_add_listener(e->buffer, &buffer_listener, e);
+    e->width = width;
+    e->height = height;
+    e->pixel = pixel;
+    e->refs = 1;
+    e->busy = false;
+    LOG("Created buffer %ux%u (pool %zu KiB)\n", width, height, shm_cache.size / 1024);
+    return e;
+}
+
+static void buffer_cache_put(cached_buffer_t *e) {
+    if (e && e->refs > 0) e->refs--;
 }
 
-static void destroy_panel_buffer(panel_t *panel) {
-    if (panel->buffer) { wl_buffer_destroy(panel->buffer); panel->buffer = NULL; }
-    if (panel->buffer_data) { munmap(panel->buffer_data, panel->buffer_size); panel->buffer_data = NULL; }
+static void buffer_cache_destroy(void) {
+    for (int i = 0; i < MAX_CACHED_BUFFERS; i++)
+        if (shm_cache.entries[i].buffer) wl_buffer_destroy(shm_cache.entries[i].buffer);
+    if (shm_cache.pool) wl_shm_pool_destroy(shm_cache.pool);
+    if (shm_cache.fd >= 0) close(shm_cache.fd);
 }
 
 /* Pointer Callbacks */
@@ -191,8 +531,8 @@ static void pointer_button(void *data, struct wl_pointer *p, uint32_t serial,
     
     for (int i = 0; i < num_panels; i++) {
         if (panels[i] && panels[i]->wl_surface == pointer_surface) {
-            LOG("Click detected - exiting\n");
-            running = 0;
+            LOG("Click detected - closing\n");
+            request_close();
             return;
         }
     }
@@ -231,32 +571,168 @@ static const struct wl_seat_listener seat_listener = {
     .name = seat_name,
 };
 
+/* Presentation Feedback Callbacks */
+static void feedback_sync_output(void *data, struct wp_presentation_feedback *fb, struct wl_output *o) {
+    (void)data; (void)fb; (void)o;
+}
+
+static void feedback_presented(void *data, struct wp_presentation_feedback *fb,
+                               uint32_t sec_hi, uint32_t sec_lo, uint32_t nsec,
+                               uint32_t refresh, uint32_t seq_hi, uint32_t seq_lo, uint32_t flags) {
+    (void)data; (void)refresh; (void)seq_hi; (void)seq_lo; (void)flags;
+    wp_presentation_feedback_destroy(fb);
+    trace.feedback_pending = false;
+    /* Only a CLOCK_MONOTONIC timestamp is comparable with t0 */
+    if (presentation_clock == CLOCK_MONOTONIC)
+        trace.presented = ((uint64_t)sec_hi << 32 | sec_lo) * 1000000 + nsec / 1000;
+    else
+        trace.presented = now_us();
+    LOG("First frame presented %lluus after t0\n", (unsigned long long)(trace.presented - trace.t0));
+}
+
+static void feedback_discarded(void *data, struct wp_presentation_feedback *fb) {
+    (void)data;
+    wp_presentation_feedback_destroy(fb);
+    trace.feedback_pending = false;
+}
+
+static const struct wp_presentation_feedback_listener feedback_listener = {
+    .sync_output = feedback_sync_output,
+    .presented = feedback_presented,
+    .discarded = feedback_discarded,
+};
+
+static void presentation_clock_id(void *data, struct wp_presentation *p, uint32_t clk_id) {
+    (void)data; (void)p;
+    presentation_clock = clk_id;
+}
+
+static const struct wp_presentation_listener presentation_listener = {
+    .clock_id = presentation_clock_id,
+};
+
+/*
+ * Scaling
+ *
+ * Viewport paths are device-exact by construction: a solid 1x1 or tile
+ * source covers the panel with no filtered edge at any scale. Full-size
+ * shm buffers are rendered at device resolution instead - sized from the
+ * fractional preferred scale through the viewport when the compositor has
+ * wp_fractional_scale_v1, otherwise at the integer output scale with
+ * wl_surface.set_buffer_scale.
+ */
+static uint32_t panel_scale120(panel_t *panel) {
+    if (panel->scale120) return panel->scale120;
+    int32_t scale = panel->output && panel->output->scale > 0 ? panel->output->scale : 1;
+    return (uint32_t)scale * 120;
+}
+
+/* Attach a buffer matching the panel's current size, scale and colour */
+static void render_panel(panel_t *panel) {
+    struct wl_buffer *buffer;
+    int32_t buffer_scale = 1;
+    
+    if (render_path == RENDER_SINGLE_PIXEL) {
+        buffer = get_solid_buffer();
+        struct wl_buffer *old = panel->solid;
+        panel->solid = buffer;
+        solid_retire(old, NULL);
+    } else {
+        uint32_t bw = TILE_SIZE, bh = TILE_SIZE;
+        if (render_path == RENDER_SHM) {
+            uint32_t s120 = panel_scale120(panel);
+            if (panel->viewport) {
+                /* Round half up, as the fractional-scale protocol specifies */
+                bw = (panel->width * s120 + 60) / 120;
+                bh = (panel->height * s120 + 60) / 120;
+            } else {
+                buffer_scale = (s120 + 119) / 120;
+                bw = panel->width * buffer_scale;
+                bh = panel->height * buffer_scale;
+            }
+        }
+        cached_buffer_t *next = buffer_cache_get(bw, bh, current_pixel());
+        /* Release the old buffer only now so an unchanged key is kept */
+        buffer_cache_put(panel->cached);
+        panel->cached = next;
+        buffer = next ? next->buffer : NULL;
+        if (next) next->busy = true;
+    }
+    if (!buffer) {
+        request_close();
+        return;
+    }
+    
+    if (panel->viewport) wp_viewport_set_destination(panel->viewport, panel->width, panel->height);
+    wl_surface_set_buffer_scale(panel->wl_surface, buffer_scale);
+    wl_surface_attach(panel->wl_surface, buffer, 0, 0);
+    
+    set_panel_opaque(panel);
+    wl_surface_damage_buffer(panel->wl_surface, 0, 0, INT32_MAX, INT32_MAX);
+    
+    /* The first commit of a show asks when it reaches the screen */
+    bool first = !trace.commit;
+    if (first && presentation && !trace.feedback_pending) {
+        struct wp_presentation_feedback *fb = wp_presentation_feedback(presentation, panel->wl_surface);
+        if (fb) {
+            wp_presentation_feedback_add_listener(fb, &feedback_listener, NULL);
+            trace.feedback_pending = true;
+        }
+    }
+    wl_surface_commit(panel->wl_surface);
+    if (first) trace.commit = now_us();
+    if (!t_commit) { t_commit = now_sec(); report_timing(); }
+}
+
+/* Fractional Scale Callbacks */
+static void fractional_preferred_scale(void *data, struct wp_fractional_scale_v1 *fs, uint32_t scale) {
+    (void)fs;
+    panel_t *panel = data;
+    if (panel->scale120 == scale) return;
+    panel->scale120 = scale;
+    LOG("Panel on %s: preferred scale %u/120\n",
+        panel->output ? panel->output->name : "?", scale);
+    /* Only the full-size path has anything to re-render */
+    if (panel->configured && render_path == RENDER_SHM) render_panel(panel);
+}
+
+static const struct wp_fractional_scale_v1_listener fractional_listener = {
+    .preferred_scale = fractional_preferred_scale,
+};
+
 /* Layer Surface Callbacks */
+static bool restyle_resize(panel_t *panel);
+
 static void layer_configure(void *data, struct zwlr_layer_surface_v1 *surface,
                            uint32_t serial, uint32_t width, uint32_t height) {
     panel_t *panel = data;
     
     zwlr_layer_surface_v1_ack_configure(surface, serial);
+    if (!t_configure) t_configure = now_sec();
+    if (!trace.configure) trace.configure = now_us();
     
     if (width > 0) panel->width = width;
     if (height > 0) panel->height = height;
     
-    destroy_panel_buffer(panel);
-    if (!create_panel_buffer(panel)) {
-        running = 0;
-        return;
-    }
+    /* This render carries the current style, so a frame still out would only
+     * repeat it; all a pending restyle can still want is a newer size */
+    if (panel->frame) { wl_callback_destroy(panel->frame); panel->frame = NULL; }
+    panel->resizing = false;
+    panel->restyle_pending = false;
     
-    wl_surface_attach(panel->wl_surface, panel->buffer, 0, 0);
-    wl_surface_damage_buffer(panel->wl_surface, 0, 0, panel->width, panel->height);
-    wl_surface_commit(panel->wl_surface);
+    render_panel(panel);
     panel->configured = true;
+    restyle_resize(panel);
 }
 
+static void remove_panel(panel_t *panel);
+
+/* Usually the panel's output is going away; the other panels stay */
 static void layer_closed(void *data, struct zwlr_layer_surface_v1 *surface) {
     (void)surface;
-    ((panel_t *)data)->configured = false;
-    running = 0;
+    panel_t *panel = data;
+    LOG("Panel on %s closed\n", panel->output ? panel->output->name : "?");
+    remove_panel(panel);
 }
 
 static const struct zwlr_layer_surface_v1_listener layer_listener = {
@@ -265,37 +741,52 @@ static const struct zwlr_layer_surface_v1_listener layer_listener = {
 };
 
 /* Output Callbacks */
+static void output_ready(output_t *out);
+
 static output_t *find_output(struct wl_output *wl) {
     for (int i = 0; i < num_outputs; i++)
-        if (outputs[i].wl_output == wl) return &outputs[i];
+        if (outputs[i]->wl_output == wl) return outputs[i];
     return NULL;
 }
 
 static void output_geometry(void *d, struct wl_output *o, int32_t x, int32_t y,
                            int32_t pw, int32_t ph, int32_t sp, const char *mk,
                            const char *md, int32_t tr) {
-    (void)d; (void)pw; (void)ph; (void)sp; (void)mk; (void)md; (void)tr;
+    (void)d; (void)pw; (void)ph; (void)sp; (void)tr;
     output_t *out = find_output(o);
-    if (out) { out->x = x; out->y = y; }
+    if (!out) return;
+    out->x = x;
+    out->y = y;
+    snprintf(out->make, sizeof(out->make), "%s", mk ? mk : "");
+    snprintf(out->model, sizeof(out->model), "%s", md ? md : "");
 }
 
 static void output_mode(void *d, struct wl_output *o, uint32_t flags, int32_t w, int32_t h, int32_t r) {
-    (void)d; (void)r;
+    (void)d;
     if (!(flags & WL_OUTPUT_MODE_CURRENT)) return;
     output_t *out = find_output(o);
-    if (out) { out->width = w; out->height = h; }
+    if (out) { out->width = w; out->height = h; out->refresh = r; }
 }
 
 static void output_done(void *d, struct wl_output *o) {
     (void)d;
     output_t *out = find_output(o);
-    if (out) out->done = true;
+    if (!out) return;
+    out->done = true;
+    if (globals_done) output_ready(out);
 }
 
 static void output_scale(void *d, struct wl_output *o, int32_t f) {
     (void)d;
     output_t *out = find_output(o);
-    if (out) out->scale = f;
+    if (!out || out->scale == f) return;
+    out->scale = f;
+    /* Integer-scaled panels follow the output; fractional ones get their own event */
+    if (render_path != RENDER_SHM) return;
+    for (int i = 0; i < num_panels; i++) {
+        panel_t *panel = panels[i];
+        if (panel->output == out && panel->configured && !panel->scale120) render_panel(panel);
+    }
 }
 
 static void output_name(void *d, struct wl_output *o, const char *name) {
@@ -304,7 +795,11 @@ static void output_name(void *d, struct wl_output *o, const char *name) {
     if (out && name) strncpy(out->name, name, sizeof(out->name) - 1);
 }
 
-static void output_desc(void *d, struct wl_output *o, const char *desc) { (void)d; (void)o; (void)desc; }
+static void output_desc(void *d, struct wl_output *o, const char *desc) {
+    (void)d;
+    output_t *out = find_output(o);
+    if (out && desc) snprintf(out->description, sizeof(out->description), "%s", desc);
+}
 
 static const struct wl_output_listener output_listener = {
     .geometry = output_geometry, .mode = output_mode, .done = output_done,
@@ -312,6 +807,40 @@ static const struct wl_output_listener output_listener = {
 };
 
 /* Registry Callbacks */
+static void add_output(struct wl_registry *reg, uint32_t name, uint32_t ver) {
+    if (num_outputs == outputs_cap) {
+        int cap = outputs_cap ? outputs_cap * 2 : 4;
+        output_t **grown = realloc(outputs, cap * sizeof(*outputs));
+        if (!grown) { ERR("Out of memory tracking outputs\n"); return; }
+        outputs = grown;
+        outputs_cap = cap;
+    }
+    output_t *out = calloc(1, sizeof(*out));
+    if (!out) { ERR("Out of memory tracking outputs\n"); return; }
+    out->global = name;
+    out->scale = 1;
+    snprintf(out->name, sizeof(out->name), "output-%d", num_outputs);
+    out->wl_output = wl_registry_bind(reg, name, &wl_output_interface, ver < 4 ? ver : 4);
+    wl_output_add_listener(out->wl_output, &output_listener, NULL);
+    outputs[num_outputs++] = out;
+}
+
+static void release_output(output_t *out) {
+    if (!out->wl_output) return;
+    if (wl_output_get_version(out->wl_output) >= WL_OUTPUT_RELEASE_SINCE_VERSION)
+        wl_output_release(out->wl_output);
+    else
+        wl_output_destroy(out->wl_output);
+    out->wl_output = NULL;
+}
+
+static void destroy_output(output_t *out) {
+    release_output(out);
+    free(out);
+}
+
+static void remove_output_panels(output_t *out);
+
 static void registry_global(void *data, struct wl_registry *reg, uint32_t name,
                            const char *iface, uint32_t ver) {
     (void)data;
@@ -320,24 +849,39 @@ static void registry_global(void *data, struct wl_registry *reg, uint32_t name,
         wl_compositor = wl_registry_bind(reg, name, &wl_compositor_interface, 4);
     } else if (strcmp(iface, wl_shm_interface.name) == 0) {
         wl_shm = wl_registry_bind(reg, name, &wl_shm_interface, 1);
+        wl_shm_add_listener(wl_shm, &shm_listener, NULL);
     } else if (strcmp(iface, wl_seat_interface.name) == 0) {
         wl_seat = wl_registry_bind(reg, name, &wl_seat_interface, ver < 5 ? ver : 5);
         wl_seat_add_listener(wl_seat, &seat_listener, NULL);
     } else if (strcmp(iface, wl_output_interface.name) == 0) {
-        if (num_outputs < MAX_OUTPUTS) {
-            output_t *out = &outputs[num_outputs++];
-            memset(out, 0, sizeof(*out));
-            out->scale = 1;
-            snprintf(out->name, sizeof(out->name), "output-%d", num_outputs - 1);
-            out->wl_output = wl_registry_bind(reg, name, &wl_output_interface, ver < 4 ? ver : 4);
-            wl_output_add_listener(out->wl_output, &output_listener, NULL);
-        }
+        add_output(reg, name, ver);
     } else if (strcmp(iface, zwlr_layer_shell_v1_interface.name) == 0) {
         layer_shell = wl_registry_bind(reg, name, &zwlr_layer_shell_v1_interface, ver < 4 ? ver : 4);
+    } else if (strcmp(iface, wp_viewporter_interface.name) == 0) {
+        viewporter = wl_registry_bind(reg, name, &wp_viewporter_interface, 1);
+    } else if (strcmp(iface, wp_single_pixel_buffer_manager_v1_interface.name) == 0) {
+        single_pixel_mgr = wl_registry_bind(reg, name, &wp_single_pixel_buffer_manager_v1_interface, 1);
+    } else if (strcmp(iface, wp_presentation_interface.name) == 0) {
+        presentation = wl_registry_bind(reg, name, &wp_presentation_interface, 1);
+        wp_presentation_add_listener(presentation, &presentation_listener, NULL);
+    } else if (strcmp(iface, wp_fractional_scale_manager_v1_interface.name) == 0) {
+        fractional_mgr = wl_registry_bind(reg, name, &wp_fractional_scale_manager_v1_interface, 1);
     }
 }
 
-static void registry_remove(void *d, struct wl_registry *r, uint32_t n) { (void)d; (void)r; (void)n; }
+static void registry_remove(void *d, struct wl_registry *r, uint32_t name) {
+    (void)d; (void)r;
+    for (int i = 0; i < num_outputs; i++) {
+        output_t *out = outputs[i];
+        if (out->global != name) continue;
+        LOG("Output %s removed\n", out->name);
+        remove_output_panels(out);
+        destroy_output(out);
+        memmove(&outputs[i], &outputs[i + 1], (num_outputs - i - 1) * sizeof(*outputs));
+        num_outputs--;
+        return;
+    }
+}
 
 static const struct wl_registry_listener registry_listener = {
     .global = registry_global,
@@ -345,15 +889,36 @@ static const struct wl_registry_listener registry_listener = {
 };
 
 /* Panel Creation */
-static panel_t *create_panel(output_t *output, uint32_t anchor, uint32_t w, uint32_t h) {
+
+/* A strip is the border width across the edge it hugs; 0 lets the output's extent fill in */
+static void panel_wanted_size(uint32_t anchor, uint32_t *w, uint32_t *h) {
+    const uint32_t lr = ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT | ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT;
+    const uint32_t tb = ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP | ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM;
+    *w = (anchor & lr) == lr ? 0 : cfg_border_width;
+    *h = (anchor & tb) == tb ? 0 : cfg_border_width;
+}
+
+static panel_t *create_panel(output_t *output, uint32_t anchor) {
     panel_t *panel = calloc(1, sizeof(panel_t));
     if (!panel) return NULL;
     
-    panel->width = w;
-    panel->height = h;
+    uint32_t w, h;
+    panel_wanted_size(anchor, &w, &h);
+    panel->output = output;
+    panel->anchor = anchor;
+    panel->width = panel->req_width = w;
+    panel->height = panel->req_height = h;
     
     panel->wl_surface = wl_compositor_create_surface(wl_compositor);
     if (!panel->wl_surface) { free(panel); return NULL; }
+    /* Full-size buffers only need a viewport when they are fractionally scaled */
+    if (viewporter && (render_path != RENDER_SHM || fractional_mgr))
+        panel->viewport = wp_viewporter_get_viewport(viewporter, panel->wl_surface);
+    if (fractional_mgr && panel->viewport) {
+        panel->fractional = wp_fractional_scale_manager_v1_get_fractional_scale(fractional_mgr,
+                                                                                panel->wl_surface);
+        wp_fractional_scale_v1_add_listener(panel->fractional, &fractional_listener, panel);
+    }
     
     panel->layer_surface = zwlr_layer_shell_v1_get_layer_surface(
         layer_shell, panel->wl_surface, output ? output->wl_output : NULL,
@@ -378,93 +943,593 @@ static panel_t *create_panel(output_t *output, uint32_t anchor, uint32_t w, uint
 
 static void destroy_panel(panel_t *panel) {
     if (!panel) return;
-    destroy_panel_buffer(panel);
+    if (panel->frame) wl_callback_destroy(panel->frame);
+    solid_retire(panel->solid, panel);
+    buffer_cache_put(panel->cached);
+    if (panel->fractional) wp_fractional_scale_v1_destroy(panel->fractional);
+    if (panel->viewport) wp_viewport_destroy(panel->viewport);
     if (panel->layer_surface) zwlr_layer_surface_v1_destroy(panel->layer_surface);
     if (panel->wl_surface) wl_surface_destroy(panel->wl_surface);
     free(panel);
 }
 
-/* Config Loading */
-static char *get_config_value(const char *path, const char *key) {
-    FILE *f = fopen(path, "r");
-    if (!f) return NULL;
-    
-    static char value[256];
-    char line[512];
-    size_t keylen = strlen(key);
-    
-    while (fgets(line, sizeof(line), f)) {
-        if (line[0] == '#' || line[0] == ';' || line[0] == '[') continue;
-        char *eq = strchr(line, '=');
-        if (!eq) continue;
-        
-        char *k = line;
-        while (*k == ' ' || *k == '\t') k++;
-        char *kend = eq;
-        while (kend > k && (*(kend-1) == ' ' || *(kend-1) == '\t')) kend--;
-        
-        if ((size_t)(kend - k) != keylen || strncmp(k, key, keylen) != 0) continue;
-        
-        char *v = eq + 1;
-        while (*v == ' ' || *v == '\t') v++;
-        char *vend = v + strlen(v);
-        while (vend > v && (*(vend-1) == '\n' || *(vend-1) == '\r' || *(vend-1) == ' ')) vend--;
-        *vend = '\0';
-        
-        if (vend - v >= 2 && v[0] == '"' && *(vend-1) == '"') {
-            v++;
-            *(vend-1) = '\0';
-        }
-        
-        strncpy(value, v, sizeof(value) - 1);
-        fclose(f);
-        return value;
+static void add_panel(output_t *output, uint32_t anchor) {
+    if (num_panels == panels_cap) {
+        int cap = panels_cap ? panels_cap * 2 : 8;
+        panel_t **grown = realloc(panels, cap * sizeof(*panels));
+        if (!grown) { ERR("Out of memory creating panel\n"); return; }
+        panels = grown;
+        panels_cap = cap;
+    }
+    panel_t *panel = create_panel(output, anchor);
+    if (panel) panels[num_panels++] = panel;
+}
+
+static void remove_panel_at(int i) {
+    panel_t *panel = panels[i];
+    if (panel->wl_surface == pointer_surface) pointer_surface = NULL;
+    panels[i] = panels[--num_panels];
+    panels[num_panels] = NULL;
+    destroy_panel(panel);
+}
+
+static void remove_panel(panel_t *panel) {
+    for (int i = 0; i < num_panels; i++)
+        if (panels[i] == panel) { remove_panel_at(i); return; }
+}
+
+static void remove_output_panels(output_t *out) {
+    for (int i = num_panels - 1; i >= 0; i--)
+        if (panels[i]->output == out) remove_panel_at(i);
+}
+
+static void create_output_panels(output_t *target) {
+    if (!target->wl_output) return;
+    LOG("Overlay on %s (%dx%d), %s mode\n", target->name, target->width, target->height,
+        cfg_fullscreen ? "fullscreen" : "ring");
+    
+    if (cfg_fullscreen) {
+        uint32_t anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP | ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM |
+                         ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT | ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT;
+        add_panel(target, anchor);
+    } else {
+        add_panel(target,
+            ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP | ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT | ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT);
+        add_panel(target,
+            ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM | ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT | ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT);
+        add_panel(target,
+            ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT | ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP | ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM);
+        add_panel(target,
+            ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT | ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP | ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM);
     }
-    fclose(f);
+}
+
+static output_t *resolve_screen(const char *name) {
+    for (int i = 0; i < num_outputs; i++)
+        if (strcmp(outputs[i]->name, name) == 0) return outputs[i];
+    
+    char *end;
+    long idx = strtol(name, &end, 10);
+    if (*end == '\0' && idx >= 0 && idx < num_outputs) return outputs[idx];
     return NULL;
 }
 
-static void load_config(void) {
-    const char *home = getenv("HOME");
-    if (!home) {
-        struct passwd *pw = getpwuid(getuid());
-        if (pw) home = pw->pw_dir;
+static bool output_lit(output_t *output) {
+    for (int i = 0; i < num_panels; i++)
+        if (panels[i]->output == output) return true;
+    return false;
+}
+
+/* Append a comma-separated list of screens; "all" selects every output */
+static void add_screens(const char *list) {
+    char buf[256], *save, *tok;
+    snprintf(buf, sizeof(buf), "%s", list);
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        while (*tok == ' ') tok++;
+        if (strcmp(tok, "all") == 0) cfg_all_screens = true;
+        else if (*tok && cfg_num_screens < MAX_SCREENS)
+            snprintf(cfg_screens[cfg_num_screens++], sizeof(cfg_screens[0]), "%s", tok);
+    }
+}
+
+static void clear_screens(void) {
+    cfg_num_screens = 0;
+    cfg_all_screens = false;
+}
+
+/* Create panels for every selected screen; returns the number of screens lit */
+static int show_panels(void) {
+    if (cfg_all_screens) {
+        for (int i = 0; i < num_outputs; i++)
+            if (!output_lit(outputs[i])) create_output_panels(outputs[i]);
+        return num_outputs;
     }
-    if (!home) return;
     
+    if (cfg_num_screens == 0) {
+        if (num_outputs == 0) return 0;
+        create_output_panels(outputs[0]);
+        return 1;
+    }
+    
+    int lit = 0;
+    for (int i = 0; i < cfg_num_screens; i++) {
+        output_t *target = resolve_screen(cfg_screens[i]);
+        if (!target) { ERR("Screen '%s' not found\n", cfg_screens[i]); continue; }
+        if (output_lit(target)) continue;
+        create_output_panels(target);
+        lit++;
+    }
+    return lit;
+}
+
+static void hide_panels(void) {
+    for (int i = 0; i < num_panels; i++) {
+        destroy_panel(panels[i]);
+        panels[i] = NULL;
+    }
+    num_panels = 0;
+    pointer_surface = NULL;
+}
+
+/*
+ * Restyle
+ *
+ * "set" on a shown light changes the existing panels in place. A new
+ * colour or brightness re-picks the single-pixel buffer (or a cached shm
+ * buffer) and commits; a new width only re-sizes the layer surfaces, and
+ * the configure that answers re-renders them. Each panel restyles at most
+ * once per frame: while its frame callback (or, for a resize, which
+ * attaches no buffer and so may never get one, the configure) is out,
+ * newer settings just mark it pending, so a dragged slider costs one
+ * commit per refresh no matter how fast the commands arrive. Screens and
+ * fullscreen still rebuild the panels.
+ */
+static void restyle_panel(panel_t *panel);
+
+static void restyle_frame_done(void *data, struct wl_callback *cb, uint32_t time) {
+    (void)time;
+    panel_t *panel = data;
+    wl_callback_destroy(cb);
+    panel->frame = NULL;
+    if (!panel->restyle_pending) return;
+    panel->restyle_pending = false;
+    restyle_panel(panel);
+}
+
+static const struct wl_callback_listener restyle_frame_listener = { .done = restyle_frame_done };
+
+/* Ask for the size the current width wants; its configure re-renders */
+static bool restyle_resize(panel_t *panel) {
+    uint32_t w, h;
+    panel_wanted_size(panel->anchor, &w, &h);
+    if (w == panel->req_width && h == panel->req_height) return false;
+    panel->req_width = w;
+    panel->req_height = h;
+    panel->resizing = true;
+    zwlr_layer_surface_v1_set_size(panel->layer_surface, w, h);
+    wl_surface_commit(panel->wl_surface);
+    return true;
+}
+
+static void restyle_panel(panel_t *panel) {
+    if (panel->frame || panel->resizing) { panel->restyle_pending = true; return; }
+    if (restyle_resize(panel)) return;
+    /* Not configured yet: the first configure renders with the new settings */
+    if (!panel->configured) return;
+
+    panel->frame = wl_surface_frame(panel->wl_surface);
+    wl_callback_add_listener(panel->frame, &restyle_frame_listener, panel);
+    render_panel(panel);
+}
+
+/* Whether show_panels() would light this output */
+static bool output_selected(output_t *out) {
+    if (cfg_all_screens) return true;
+    if (cfg_num_screens == 0) return num_outputs > 0 && out == outputs[0];
+    for (int i = 0; i < cfg_num_screens; i++)
+        if (resolve_screen(cfg_screens[i]) == out) return true;
+    return false;
+}
+
+/* An output's info is complete: at startup, or later when it is plugged in */
+static void output_ready(output_t *out) {
+    if (cfg_list_only) return;
+    /*
+     * Names don't change, so a standalone overlay never needs an output it
+     * wasn't asked for; the entry stays so indices keep resolving the same
+     */
+    if (!cfg_daemon && !output_selected(out)) {
+        LOG("Releasing unselected output %s\n", out->name);
+        release_output(out);
+        return;
+    }
+    bool on = outputs_settled ? shown : !cfg_daemon;
+    if (!on || !output_selected(out) || output_lit(out)) return;
+    if (outputs_settled) LOG("Output %s added\n", out->name);
+    create_output_panels(out);
+}
+
+/* Output Inventory */
+static void json_string(char *buf, size_t len, size_t *pos, const char *s) {
+    if (*pos < len) *pos += snprintf(buf + *pos, len - *pos, "\"");
+    for (; *s && *pos < len; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') *pos += snprintf(buf + *pos, len - *pos, "\\%c", c);
+        else if (c < 0x20) *pos += snprintf(buf + *pos, len - *pos, "\\u%04x", c);
+        else buf[(*pos)++] = c;
+    }
+    if (*pos < len) *pos += snprintf(buf + *pos, len - *pos, "\"");
+}
+
+/*
+ * One line of JSON, an array of
+ *   {"name","description","make","model","width","height","refresh","x","y","scale"}
+ * with refresh in mHz. False if it didn't fit in len.
+ */
+static bool format_inventory(char *buf, size_t len) {
+    size_t pos = snprintf(buf, len, "[");
+    for (int i = 0; i < num_outputs && pos < len; i++) {
+        const output_t *o = outputs[i];
+        if (i && pos < len) buf[pos++] = ',';
+        const char *keys[] = { "name", "description", "make", "model" };
+        const char *vals[] = { o->name, o->description, o->make, o->model };
+        for (int k = 0; k < 4 && pos < len; k++) {
+            pos += snprintf(buf + pos, len - pos, "%s\"%s\":", k ? "," : "{", keys[k]);
+            json_string(buf, len, &pos, vals[k]);
+        }
+        if (pos < len)
+            pos += snprintf(buf + pos, len - pos,
+                            ",\"width\":%d,\"height\":%d,\"refresh\":%d,\"x\":%d,\"y\":%d,\"scale\":%d}",
+                            o->width, o->height, o->refresh, o->x, o->y, o->scale);
+    }
+    if (pos < len) pos += snprintf(buf + pos, len - pos, "]");
+    return pos < len;
+}
+
+/* Startup Callbacks */
+
+static void outputs_sync_done(void *data, struct wl_callback *cb, uint32_t time) {
+    (void)data; (void)time;
+    wl_callback_destroy(cb);
+    
+    if (cfg_list_only && cfg_json) {
+        char buf[INVENTORY_MAX];
+        if (format_inventory(buf, sizeof(buf))) {
+            printf("%s\n", buf);
+        } else {
+            ERR("Too many outputs to list\n");
+            exit_status = 1;
+        }
+        report_timing();
+        running = false;
+        return;
+    }
+    if (cfg_list_only) {
+        printf("Available screens:\n");
+        for (int i = 0; i < num_outputs; i++)
+            printf("  %d: %s (%dx%d @ %d,%d)\n", i, outputs[i]->name,
+                   outputs[i]->width, outputs[i]->height, outputs[i]->x, outputs[i]->y);
+        report_timing();
+        running = false;
+        return;
+    }
+    
+    if (!cfg_daemon) {
+        if (num_outputs == 0) { ERR("No outputs found\n"); exit_status = 1; running = false; return; }
+        /* Picks up outputs without a done event and reports unknown screens */
+        show_panels();
+        if (num_panels == 0) { exit_status = 1; running = false; return; }
+        shown = true;
+    }
+    outputs_settled = true;
+    
+    /* Commands only make sense once the outputs are known */
+    if (listen_fd >= 0) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = EV_LISTEN };
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) < 0)
+            ERR("Failed to watch control socket: %s\n", strerror(errno));
+    }
+}
+
+static const struct wl_callback_listener outputs_sync_listener = { .done = outputs_sync_done };
+
+static void globals_sync_done(void *data, struct wl_callback *cb, uint32_t time) {
+    (void)data; (void)time;
+    wl_callback_destroy(cb);
+    t_globals = now_sec();
+    
+    if (!wl_compositor || !wl_shm || !layer_shell) {
+        ERR("Missing required Wayland interfaces\n");
+        exit_status = 1;
+        running = false;
+        return;
+    }
+    choose_render_path();
+    globals_done = true;
+    
+    /* Outputs whose info already arrived can be lit straight away */
+    for (int i = 0; i < num_outputs; i++)
+        if (outputs[i]->done) output_ready(outputs[i]);
+    
+    wl_callback_add_listener(wl_display_sync(wl_display), &outputs_sync_listener, NULL);
+}
+
+static const struct wl_callback_listener globals_sync_listener = { .done = globals_sync_done };
+
+/* Config Loading */
+static void load_config(void) {
+    static config_t cfg;
     char path[PATH_MAX];
-    snprintf(path, sizeof(path), "%s/.config/ringlight/config.ini", home);
+    if (!config_path(path, sizeof(path)) || config_load(&cfg, path) < 0) return;
+
+    config_get_int(&cfg, "overlay", "width", &cfg_border_width);
+    config_get_int(&cfg, "overlay", "brightness", &cfg_brightness);
+    config_get_color(&cfg, "overlay", "color", &cfg_color);
+    config_get_bool(&cfg, "overlay", "fullscreen", &cfg_fullscreen);
+}
+
+/* Daemon */
+static bool set_option(const char *key, const char *val) {
+    if (strcmp(key, "width") == 0) {
+        cfg_border_width = config_int(key, val);
+    } else if (strcmp(key, "brightness") == 0) {
+        cfg_brightness = config_int(key, val);
+    } else if (strcmp(key, "color") == 0) {
+        cfg_color = config_color(val);
+    } else if (strcmp(key, "fullscreen") == 0) {
+        cfg_fullscreen = config_bool(val);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* What show and set may change, so a command that fails changes nothing */
+typedef struct {
+    int width, brightness;
+    uint32_t color;
+    bool fullscreen, all_screens;
+    int num_screens;
+    char screens[MAX_SCREENS][64];
+} selection_t;
+
+static void selection_save(selection_t *s) {
+    s->width = cfg_border_width;
+    s->brightness = cfg_brightness;
+    s->color = cfg_color;
+    s->fullscreen = cfg_fullscreen;
+    s->all_screens = cfg_all_screens;
+    s->num_screens = cfg_num_screens;
+    memcpy(s->screens, cfg_screens, sizeof(cfg_screens));
+}
+
+static void selection_restore(const selection_t *s) {
+    cfg_border_width = s->width;
+    cfg_brightness = s->brightness;
+    cfg_color = s->color;
+    cfg_fullscreen = s->fullscreen;
+    cfg_all_screens = s->all_screens;
+    cfg_num_screens = s->num_screens;
+    memcpy(cfg_screens, s->screens, sizeof(cfg_screens));
+}
+
+/*
+ * show [screen=S[,S...]|all] [width=N] [color=RRGGBB] [brightness=N] [fullscreen=0|1] [t0=USEC]
+ * set  <same options>   restyle, in place if currently shown
+ * trace                 marks of the latest show: t0 configure commit presented
+ * list                  the outputs, as --list --json prints them
+ * hide | status | ping | quit
+ */
+static void handle_command(char *line, char *reply, size_t len) {
+    char *save;
+    char *verb = strtok_r(line, " \t\r", &save);
+    if (!verb) { snprintf(reply, len, "error empty command"); return; }
     
-    char *v;
-    if ((v = get_config_value(path, "width"))) {
-        cfg_border_width = atoi(v);
-        if (cfg_border_width < 1) cfg_border_width = 1;
-        if (cfg_border_width > 500) cfg_border_width = 500;
+    bool show = strcmp(verb, "show") == 0;
+    if (show || strcmp(verb, "set") == 0) {
+        static selection_t old;
+        selection_save(&old);
+        uint32_t old_pixel = current_pixel();
+
+        bool screens_given = false;
+        uint64_t t0 = now_us();
+        char *tok;
+        while ((tok = strtok_r(NULL, " \t\r", &save))) {
+            char *eq = strchr(tok, '=');
+            if (!eq) {
+                selection_restore(&old);
+                snprintf(reply, len, "error expected key=value, got '%s'", tok);
+                return;
+            }
+            *eq = '\0';
+            if (strcmp(tok, "screen") == 0) {
+                if (!screens_given) { clear_screens(); screens_given = true; }
+                add_screens(eq + 1);
+            } else if (strcmp(tok, "t0") == 0) {
+                t0 = strtoull(eq + 1, NULL, 10);
+            } else if (!set_option(tok, eq + 1)) {
+                selection_restore(&old);
+                snprintf(reply, len, "error unknown option '%s'", tok);
+                return;
+            }
+        }
+        if (show) {
+            trace.t0 = t0;
+            trace.configure = trace.commit = trace.presented = 0;
+        }
+
+        bool rebuild = show || old.fullscreen != cfg_fullscreen || old.all_screens != cfg_all_screens ||
+                       old.num_screens != cfg_num_screens;
+        for (int i = 0; i < cfg_num_screens && !rebuild; i++)
+            rebuild = strcmp(old.screens[i], cfg_screens[i]) != 0;
+
+        if (shown && !show && !rebuild) {
+            if (old_pixel != current_pixel() || old.width != cfg_border_width)
+                for (int i = 0; i < num_panels; i++) restyle_panel(panels[i]);
+        } else if (show) {
+            bool was_shown = shown;
+            hide_panels();
+            shown = show_panels() > 0;
+            if (!shown) {
+                /* Put back the light this show replaced, as it was */
+                selection_restore(&old);
+                if (was_shown) shown = show_panels() > 0;
+                snprintf(reply, len, "error no screen to show");
+                return;
+            }
+        } else if (shown) {
+            /* Stays on even if no selected screen is plugged in right now */
+            hide_panels();
+            show_panels();
+        }
+        snprintf(reply, len, "ok");
+    } else if (strcmp(verb, "hide") == 0) {
+        hide_panels();
+        shown = false;
+        snprintf(reply, len, "ok");
+    } else if (strcmp(verb, "trace") == 0) {
+        snprintf(reply, len, "ok t0=%llu configure=%llu commit=%llu presented=%llu",
+                 (unsigned long long)trace.t0, (unsigned long long)trace.configure,
+                 (unsigned long long)trace.commit, (unsigned long long)trace.presented);
+    } else if (strcmp(verb, "list") == 0) {
+        size_t n = snprintf(reply, len, "ok ");
+        if (n >= len || !format_inventory(reply + n, len - n))
+            snprintf(reply, len, "error too many outputs to list");
+    } else if (strcmp(verb, "status") == 0) {
+        snprintf(reply, len, "ok %s", shown ? "shown" : "hidden");
+    } else if (strcmp(verb, "ping") == 0) {
+        snprintf(reply, len, "ok");
+    } else if (strcmp(verb, "quit") == 0) {
+        running = false;
+        snprintf(reply, len, "ok");
+    } else {
+        snprintf(reply, len, "error unknown command '%s'", verb);
     }
-    if ((v = get_config_value(path, "brightness"))) {
-        cfg_brightness = atoi(v);
-        if (cfg_brightness < 1) cfg_brightness = 1;
-        if (cfg_brightness > 100) cfg_brightness = 100;
+}
+
+static void client_close(client_t *c) {
+    close(c->fd);
+    c->fd = -1;
+    c->len = 0;
+}
+
+static void client_read(client_t *c) {
+    ssize_t n = recv(c->fd, c->buf + c->len, sizeof(c->buf) - 1 - c->len, 0);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    if (n <= 0) { client_close(c); return; }
+    c->len += n;
+    
+    char *start = c->buf, *nl;
+    while ((nl = memchr(start, '\n', c->buf + c->len - start))) {
+        *nl = '\0';
+        char reply[CTL_REPLY_MAX];
+        handle_command(start, reply, sizeof(reply) - 1);
+        strcat(reply, "\n");
+        send(c->fd, reply, strlen(reply), MSG_NOSIGNAL | MSG_DONTWAIT);
+        start = nl + 1;
     }
-    if ((v = get_config_value(path, "color"))) {
-        if (v[0] == '#') v++;
-        cfg_color = strtoul(v, NULL, 16);
+    c->len -= start - c->buf;
+    memmove(c->buf, start, c->len);
+    
+    if (c->len == sizeof(c->buf) - 1) {
+        ERR("Control command too long, dropping client\n");
+        client_close(c);
     }
-    if ((v = get_config_value(path, "fullscreen"))) {
-        cfg_fullscreen = (strcmp(v, "true") == 0 || strcmp(v, "1") == 0);
+}
+
+static void accept_clients(void) {
+    int fd;
+    while ((fd = ctl_accept(listen_fd)) >= 0) {
+        client_t *slot = NULL;
+        for (int i = 0; i < MAX_CLIENTS && !slot; i++)
+            if (clients[i].fd < 0) slot = &clients[i];
+        if (!slot) { close(fd); continue; }
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = EV_CLIENT + (slot - clients) };
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) { close(fd); continue; }
+        slot->fd = fd;
+        slot->len = 0;
     }
 }
 
+/* Returns 1 on success, 0 if another daemon already owns the socket, -1 on error */
+static int setup_daemon(void) {
+    for (int i = 0; i < MAX_CLIENTS; i++) clients[i].fd = -1;
+    
+    if (!ctl_socket_path(CTL_OVERLAY_SOCKET, socket_path, sizeof(socket_path))) {
+        ERR("Control socket path too long\n");
+        return -1;
+    }
+    listen_fd = ctl_listen(socket_path, &lock_fd);
+    if (listen_fd < 0) {
+        if (errno == EADDRINUSE) { LOG("Daemon already running\n"); return 0; }
+        ERR("Failed to listen on %s: %s\n", socket_path, strerror(errno));
+        return -1;
+    }
+    LOG("Daemon listening on %s\n", socket_path);
+    return 1;
+}
+
+static void cleanup_daemon(void) {
+    for (int i = 0; i < MAX_CLIENTS; i++)
+        if (clients[i].fd >= 0) client_close(&clients[i]);
+    if (listen_fd >= 0) { close(listen_fd); unlink(socket_path); }
+    if (lock_fd >= 0) close(lock_fd);
+}
+
+static bool epoll_watch(int fd, uint32_t tag) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = tag };
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+/* SIGINT/SIGTERM become readable events instead of interrupting the loop */
+static bool setup_event_loop(int wl_fd) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0) return false;
+    
+    signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (signal_fd < 0 || epoll_fd < 0) return false;
+    
+    return epoll_watch(wl_fd, EV_WAYLAND) && epoll_watch(signal_fd, EV_SIGNAL);
+}
+
+static void read_signals(void) {
+    struct signalfd_siginfo si;
+    while (read(signal_fd, &si, sizeof(si)) == sizeof(si)) {
+        LOG("Caught signal %u, exiting\n", si.ssi_signo);
+        running = false;
+    }
+}
+
+static void count_wakeup(void) {
+    wakeups++;
+    window_wakeups++;
+    if (!cfg_verbose) return;
+    double now = now_sec();
+    if (now - window_start < 60) return;
+    LOG("%.1f wakeups/min over the last %.0fs\n",
+        window_wakeups * 60 / (now - window_start), now - window_start);
+    window_wakeups = 0;
+    window_start = now;
+}
+
 /* Main */
 static void print_usage(const char *prog) {
     printf("ringlight-overlay - Screen ring light for Wayland\n\n");
     printf("Usage: %s [options]\n\n", prog);
-    printf("  -s, --screen N|NAME  Screen index or name\n");
+    printf("  -s, --screen LIST    Screen indices or names, comma-separated, or 'all'\n");
     printf("  -w, --width N        Border width in pixels (default: 80)\n");
     printf("  -c, --color RRGGBB   Color in hex (default: FFFFFF)\n");
     printf("  -b, --brightness N   Brightness 1-100 (default: 100)\n");
     printf("  -f, --fullscreen     Full screen mode\n");
     printf("  -l, --list           List screens and exit\n");
+    printf("  -j, --json           With --list, print the screens as one line of JSON\n");
+    printf("  -r, --render PATH    Force single-pixel, shm-tile or shm rendering\n");
+    printf("  -t, --timing         Print startup latency in microseconds\n");
+    printf("  -D, --daemon         Stay running and take commands on the control socket\n");
     printf("  -v, --verbose        Verbose output\n");
     printf("  -h, --help           Show this help\n");
     printf("\nClick on the overlay to close.\n");
@@ -480,144 +1545,128 @@ int main(int argc, char *argv[]) {
         {"brightness", required_argument, 0, 'b'},
         {"fullscreen", no_argument, 0, 'f'},
         {"list", no_argument, 0, 'l'},
+        {"json", no_argument, 0, 'j'},
+        {"render", required_argument, 0, 'r'},
+        {"timing", no_argument, 0, 't'},
+        {"daemon", no_argument, 0, 'D'},
         {"verbose", no_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
     
     int opt;
-    while ((opt = getopt_long(argc, argv, "s:w:c:b:flvh", long_opts, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "s:w:c:b:fljr:tDvh", long_opts, NULL)) != -1) {
         switch (opt) {
-        case 's': strncpy(cfg_target_name, optarg, sizeof(cfg_target_name) - 1); break;
-        case 'w': cfg_border_width = atoi(optarg); if (cfg_border_width < 1) cfg_border_width = 1; if (cfg_border_width > 500) cfg_border_width = 500; break;
-        case 'c': if (optarg[0] == '#') optarg++; cfg_color = strtoul(optarg, NULL, 16); break;
-        case 'b': cfg_brightness = atoi(optarg); if (cfg_brightness < 1) cfg_brightness = 1; if (cfg_brightness > 100) cfg_brightness = 100; break;
+        case 's': add_screens(optarg); break;
+        case 'w': cfg_border_width = config_int("width", optarg); break;
+        case 'c': cfg_color = config_color(optarg); break;
+        case 'b': cfg_brightness = config_int("brightness", optarg); break;
         case 'f': cfg_fullscreen = true; break;
         case 'l': cfg_list_only = true; break;
+        case 'j': cfg_json = true; break;
+        case 'r':
+            for (int i = 0; i < 3; i++)
+                if (strcmp(optarg, render_path_names[i]) == 0) cfg_render = i;
+            if (cfg_render < 0) { ERR("Unknown render path: %s\n", optarg); return 1; }
+            break;
+        case 't': cfg_timing = true; break;
+        case 'D': cfg_daemon = true; break;
         case 'v': cfg_verbose = true; break;
         case 'h': print_usage(argv[0]); return 0;
         default: print_usage(argv[0]); return 1;
         }
     }
     
+    if (cfg_daemon && !cfg_list_only) {
+        int ret = setup_daemon();
+        if (ret <= 0) return ret < 0 ? 1 : 0;
+    }
+    
+    t_start = now_sec();
+    trace.t0 = now_us();
     wl_display = wl_display_connect(NULL);
     if (!wl_display) { ERR("Failed to connect to Wayland\n"); return 1; }
+    t_connected = now_sec();
     
     wl_registry = wl_display_get_registry(wl_display);
     wl_registry_add_listener(wl_registry, &registry_listener, NULL);
-    wl_display_roundtrip(wl_display);
-    wl_display_roundtrip(wl_display);
-    wl_display_roundtrip(wl_display);
+    wl_callback_add_listener(wl_display_sync(wl_display), &globals_sync_listener, NULL);
     
-    if (!wl_compositor || !wl_shm || !layer_shell) {
-        ERR("Missing required Wayland interfaces\n");
+    int wl_fd = wl_display_get_fd(wl_display);
+    if (!setup_event_loop(wl_fd)) {
+        ERR("Failed to set up event loop: %s\n", strerror(errno));
         return 1;
     }
     
-    if (cfg_list_only) {
-        printf("Available screens:\n");
-        for (int i = 0; i < num_outputs; i++)
-            printf("  %d: %s (%dx%d @ %d,%d)\n", i, outputs[i].name,
-                   outputs[i].width, outputs[i].height, outputs[i].x, outputs[i].y);
-        wl_display_disconnect(wl_display);
-        return 0;
-    }
-    
-    if (num_outputs == 0) { ERR("No outputs found\n"); return 1; }
-    
-    /* Find target output */
-    output_t *target = NULL;
-    if (cfg_target_name[0]) {
-        for (int i = 0; i < num_outputs; i++) {
-            if (strcmp(outputs[i].name, cfg_target_name) == 0) {
-                target = &outputs[i];
-                break;
-            }
-        }
-        if (!target) {
-            char *end;
-            long idx = strtol(cfg_target_name, &end, 10);
-            if (*end == '\0' && idx >= 0 && idx < num_outputs)
-                target = &outputs[idx];
-        }
-        if (!target) {
-            ERR("Screen '%s' not found\n", cfg_target_name);
-            return 1;
-        }
-    } else {
-        target = &outputs[0];
-    }
-    
-    LOG("Overlay on %s (%dx%d), %s mode\n", target->name, target->width, target->height,
-        cfg_fullscreen ? "fullscreen" : "ring");
-    
-    /* Create panels */
-    if (cfg_fullscreen) {
-        uint32_t anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP | ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM |
-                         ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT | ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT;
-        panels[num_panels++] = create_panel(target, anchor, 0, 0);
-    } else {
-        panels[num_panels++] = create_panel(target,
-            ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP | ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT | ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT,
-            0, cfg_border_width);
-        panels[num_panels++] = create_panel(target,
-            ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM | ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT | ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT,
-            0, cfg_border_width);
-        panels[num_panels++] = create_panel(target,
-            ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT | ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP | ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM,
-            cfg_border_width, 0);
-        panels[num_panels++] = create_panel(target,
-            ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT | ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP | ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM,
-            cfg_border_width, 0);
-    }
-    
-    signal(SIGINT, sig_handler);
-    signal(SIGTERM, sig_handler);
-    
-    /* Wait for configure */
-    while (running) {
-        if (wl_display_dispatch(wl_display) < 0) break;
-        bool all_done = true;
-        for (int i = 0; i < num_panels; i++)
-            if (panels[i] && !panels[i]->configured) { all_done = false; break; }
-        if (all_done) break;
-    }
-    
     /* Main loop */
-    int wl_fd = wl_display_get_fd(wl_display);
+    loop_start = window_start = now_sec();
     while (running) {
         while (wl_display_prepare_read(wl_display) != 0)
             wl_display_dispatch_pending(wl_display);
+        if (!running) { wl_display_cancel_read(wl_display); break; }
+        /* Everything queued since the last wakeup goes out in one flush */
         wl_display_flush(wl_display);
         
-        struct pollfd pfd = { .fd = wl_fd, .events = POLLIN };
-        int ret = poll(&pfd, 1, 100);
-        
-        if (ret < 0) {
+        struct epoll_event events[4 + MAX_CLIENTS];
+        int n = epoll_wait(epoll_fd, events, 4 + MAX_CLIENTS, -1);
+        if (n < 0) {
             wl_display_cancel_read(wl_display);
             if (errno == EINTR) continue;
+            ERR("epoll_wait failed: %s\n", strerror(errno));
             break;
         }
+        count_wakeup();
         
-        if (ret > 0 && (pfd.revents & POLLIN)) {
-            wl_display_read_events(wl_display);
+        bool wayland_ready = false;
+        for (int i = 0; i < n; i++)
+            if (events[i].data.u32 == EV_WAYLAND) wayland_ready = true;
+        if (wayland_ready) {
+            if (wl_display_read_events(wl_display) < 0) { ERR("Lost Wayland connection\n"); break; }
             wl_display_dispatch_pending(wl_display);
         } else {
             wl_display_cancel_read(wl_display);
         }
+        
+        for (int i = 0; i < n; i++) {
+            uint32_t tag = events[i].data.u32;
+            if (tag == EV_SIGNAL) read_signals();
+            else if (tag == EV_LISTEN) accept_clients();
+            else if (tag >= EV_CLIENT && clients[tag - EV_CLIENT].fd >= 0) client_read(&clients[tag - EV_CLIENT]);
+        }
+        
+        if (hide_pending) {
+            hide_pending = false;
+            hide_panels();
+            shown = false;
+        }
     }
     
+    double elapsed = now_sec() - loop_start;
+    if (elapsed > 0 && !cfg_list_only)
+        LOG("%llu wakeups in %.0fs (%.2f/min)\n", (unsigned long long)wakeups, elapsed,
+            wakeups * 60 / elapsed);
+    
     /* Cleanup */
-    for (int i = 0; i < num_panels; i++) destroy_panel(panels[i]);
+    cleanup_daemon();
+    if (signal_fd >= 0) close(signal_fd);
+    if (epoll_fd >= 0) close(epoll_fd);
+    hide_panels();
     if (wl_pointer) wl_pointer_destroy(wl_pointer);
     if (wl_seat) wl_seat_destroy(wl_seat);
+    if (solid_buffer) wl_buffer_destroy(solid_buffer);
+    buffer_cache_destroy();
+    if (fractional_mgr) wp_fractional_scale_manager_v1_destroy(fractional_mgr);
+    if (presentation) wp_presentation_destroy(presentation);
+    if (single_pixel_mgr) wp_single_pixel_buffer_manager_v1_destroy(single_pixel_mgr);
+    if (viewporter) wp_viewporter_destroy(viewporter);
     if (layer_shell) zwlr_layer_shell_v1_destroy(layer_shell);
     if (wl_shm) wl_shm_destroy(wl_shm);
     if (wl_compositor) wl_compositor_destroy(wl_compositor);
-    for (int i = 0; i < num_outputs; i++)
-        if (outputs[i].wl_output) wl_output_destroy(outputs[i].wl_output);
+    free(panels);
+    for (int i = 0; i < num_outputs; i++) destroy_output(outputs[i]);
+    free(outputs);
     wl_registry_destroy(wl_registry);
     wl_display_disconnect(wl_display);
     
-    return 0;
+    return exit_status;
 }
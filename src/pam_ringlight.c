@@ -0,0 +1,62 @@
+/*
+ * RingLight PAM - Light the screen before pam_howdy opens the camera
+ *
+ *   auth  optional    pam_ringlight.so             # on, before howdy
+ *   auth  sufficient  pam_howdy.so
+ *   auth  optional    pam_ringlight.so off         # howdy failed, carry on
+ *
+ * A successful "sufficient" howdy ends the stack before the off line, so
+ * setcred, which the application calls after authenticating, sends the
+ * off as well. The monitor's hold timer catches anything that slips past
+ * both. The module never affects the result: it always returns PAM_IGNORE.
+ *
+ * Options: off, hold=SECONDS, timeout=MS
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <pwd.h>
+
+#define PAM_SM_AUTH
+#include <security/pam_modules.h>
+
+#include "control.h"
+
+#define DEFAULT_HOLD_S 30
+#define DEFAULT_TIMEOUT_MS 100
+
+static void trigger(pam_handle_t *pamh, bool on, int argc, const char **argv) {
+    int hold_s = DEFAULT_HOLD_S, timeout_ms = DEFAULT_TIMEOUT_MS;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "off") == 0) on = false;
+        else if (strncmp(argv[i], "hold=", 5) == 0) hold_s = atoi(argv[i] + 5);
+        else if (strncmp(argv[i], "timeout=", 8) == 0) timeout_ms = atoi(argv[i] + 8);
+    }
+    if (hold_s < 1) hold_s = 1;
+    if (timeout_ms < 1) timeout_ms = 1;
+
+    const char *user = NULL;
+    if (pam_get_user(pamh, &user, NULL) != PAM_SUCCESS || !user) return;
+
+    struct passwd pw, *res = NULL;
+    char buf[1024];
+    if (getpwnam_r(user, &pw, buf, sizeof(buf), &res) != 0 || !res) return;
+
+    ctl_trigger(pw.pw_uid, on, hold_s, timeout_ms);
+}
+
+PAM_EXTERN int pam_sm_authenticate(pam_handle_t *pamh, int flags, int argc, const char **argv) {
+    (void)flags;
+    trigger(pamh, true, argc, argv);
+    return PAM_IGNORE;
+}
+
+PAM_EXTERN int pam_sm_setcred(pam_handle_t *pamh, int flags, int argc, const char **argv) {
+    (void)flags;
+    trigger(pamh, false, argc, argv);
+    return PAM_IGNORE;
+}
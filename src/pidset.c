@@ -0,0 +1,84 @@
+/*
+ * RingLight Pid Set - Tracked processes and their pidfds
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "pidset.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PIDSET_MIN_CAP 16
+
+/* Fibonacci hashing spreads the sequential pids fork hands out: the top
+ * bits of pid * 2^32/phi depend on every bit of the pid */
+static uint32_t slot_of(const pidset_t *set, pid_t pid) {
+    return ((uint32_t)pid * 2654435769u) >> set->shift;
+}
+
+pidset_entry_t *pidset_find(const pidset_t *set, pid_t pid) {
+    if (!set->count || pid <= 0) return NULL;
+    for (uint32_t i = slot_of(set, pid); set->slots[i].pid; i = (i + 1) & (set->cap - 1))
+        if (set->slots[i].pid == pid) return &set->slots[i];
+    return NULL;
+}
+
+static void place(pidset_t *set, pidset_entry_t e) {
+    uint32_t i = slot_of(set, e.pid);
+    while (set->slots[i].pid) i = (i + 1) & (set->cap - 1);
+    set->slots[i] = e;
+}
+
+static bool grow(pidset_t *set) {
+    uint32_t cap = set->cap ? set->cap * 2 : PIDSET_MIN_CAP;
+    pidset_entry_t *slots = calloc(cap, sizeof(*slots));
+    if (!slots) return false;
+
+    pidset_t old = *set;
+    set->slots = slots;
+    set->cap = cap;
+    set->shift = 32 - __builtin_ctz(cap);
+    for (uint32_t i = 0; i < old.cap; i++)
+        if (old.slots[i].pid) place(set, old.slots[i]);
+    free(old.slots);
+    return true;
+}
+
+bool pidset_insert(pidset_t *set, pid_t pid, int fd) {
+    if (pid <= 0 || pidset_find(set, pid)) return true;
+    if ((set->count + 1) * 2 > set->cap && !grow(set)) return false;
+    place(set, (pidset_entry_t){ .pid = pid, .fd = fd });
+    set->count++;
+    return true;
+}
+
+bool pidset_remove(pidset_t *set, pid_t pid, int *fd) {
+    pidset_entry_t *e = pidset_find(set, pid);
+    if (!e) return false;
+    if (fd) *fd = e->fd;
+
+    /* Shift later members of the probe run back into the hole */
+    uint32_t mask = set->cap - 1, hole = e - set->slots;
+    for (uint32_t i = (hole + 1) & mask; set->slots[i].pid; i = (i + 1) & mask) {
+        uint32_t home = slot_of(set, set->slots[i].pid);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            set->slots[hole] = set->slots[i];
+            hole = i;
+        }
+    }
+    set->slots[hole].pid = 0;
+    set->count--;
+    return true;
+}
+
+void pidset_clear(pidset_t *set) {
+    if (set->slots) memset(set->slots, 0, set->cap * sizeof(*set->slots));
+    set->count = 0;
+}
+
+void pidset_free(pidset_t *set) {
+    free(set->slots);
+    *set = (pidset_t){ 0 };
+}
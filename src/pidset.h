@@ -0,0 +1,45 @@
+/*
+ * RingLight Pid Set - Tracked processes and their pidfds
+ *
+ * An open-addressing hash table keyed by pid with linear probing and
+ * backward-shift deletion, so lookups stay O(1) on every exit event and
+ * there are no tombstones to sweep. It doubles when half full and has no
+ * fixed capacity.
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef RINGLIGHT_PIDSET_H
+#define RINGLIGHT_PIDSET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef struct {
+    pid_t pid;      /* 0 marks an empty slot */
+    int fd;         /* pidfd, or -1 */
+} pidset_entry_t;
+
+typedef struct {
+    pidset_entry_t *slots;
+    uint32_t cap;   /* power of two, 0 until the first insert */
+    uint32_t count;
+    uint32_t shift; /* 32 - log2(cap): the hash keeps the product's top bits */
+} pidset_t;
+
+/* Entry for pid, or NULL */
+pidset_entry_t *pidset_find(const pidset_t *set, pid_t pid);
+
+/* Add pid unless present; false only when growing fails */
+bool pidset_insert(pidset_t *set, pid_t pid, int fd);
+
+/* Drop pid, returning its fd through fd if non-NULL; false if absent */
+bool pidset_remove(pidset_t *set, pid_t pid, int *fd);
+
+/* Forget every entry; fds are the caller's to close first */
+void pidset_clear(pidset_t *set);
+void pidset_free(pidset_t *set);
+
+#endif
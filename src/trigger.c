@@ -0,0 +1,84 @@
+/*
+ * RingLight Trigger - Turn the light on or off from an authenticator
+ *
+ * For hooks that know when the camera is about to be used, such as a
+ * Howdy wrapper or pam_exec:
+ *
+ *   auth optional pam_exec.so quiet /usr/bin/ringlight-trigger on
+ *
+ * Run as root with PAM_USER set (as pam_exec does), it targets that
+ * user's session sockets instead of root's.
+ *
+ * Copyright (C) 2024-2025 Bryan
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pwd.h>
+
+#include "control.h"
+
+#define DEFAULT_HOLD_S 30
+#define DEFAULT_TIMEOUT_MS 250
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options] on|off\n\n"
+           "Options:\n"
+           "  -u, --user NAME      Session to light (default: PAM_USER as root, else self)\n"
+           "  -H, --hold SECONDS   Turn off after this long without an off (default: %d)\n"
+           "  -t, --timeout MS     Wait this long for a reply (default: %d)\n"
+           "  -q, --quiet          Don't report failures\n"
+           "  -h, --help           Show help\n\n"
+           "Asks ringlight-monitor first, then the overlay daemon directly.\n",
+           prog, DEFAULT_HOLD_S, DEFAULT_TIMEOUT_MS);
+}
+
+int main(int argc, char *argv[]) {
+    static struct option opts[] = {
+        {"user", required_argument, 0, 'u'},
+        {"hold", required_argument, 0, 'H'},
+        {"timeout", required_argument, 0, 't'},
+        {"quiet", no_argument, 0, 'q'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    const char *user = NULL;
+    int hold_s = DEFAULT_HOLD_S, timeout_ms = DEFAULT_TIMEOUT_MS;
+    bool quiet = false;
+    int c;
+    while ((c = getopt_long(argc, argv, "u:H:t:qh", opts, NULL)) != -1) {
+        switch (c) {
+            case 'u': user = optarg; break;
+            case 'H': hold_s = atoi(optarg); if (hold_s < 1) hold_s = 1; break;
+            case 't': timeout_ms = atoi(optarg); if (timeout_ms < 1) timeout_ms = 1; break;
+            case 'q': quiet = true; break;
+            case 'h': usage(argv[0]); return 0;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind != argc - 1 || (strcmp(argv[optind], "on") != 0 && strcmp(argv[optind], "off") != 0)) {
+        usage(argv[0]);
+        return 2;
+    }
+    bool on = strcmp(argv[optind], "on") == 0;
+
+    if (!user && geteuid() == 0) user = getenv("PAM_USER");
+    uid_t uid = getuid();
+    if (user) {
+        struct passwd *pw = getpwnam(user);
+        if (!pw) { if (!quiet) fprintf(stderr, "ringlight-trigger: unknown user '%s'\n", user); return 1; }
+        uid = pw->pw_uid;
+    }
+
+    if (ctl_trigger(uid, on, hold_s, timeout_ms) < 0) {
+        if (!quiet) fprintf(stderr, "ringlight-trigger: neither the monitor nor the overlay daemon answered\n");
+        return 1;
+    }
+    return 0;
+}